@@ -21,20 +21,27 @@
 
 #pragma once
 
+#include <string_view>
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/system.hpp>
 #include <eosio/singleton.hpp>
 #include <eosio/transaction.hpp>
 #include "affiliate/datastore.hpp"
+#include "bank/datastore.hpp"
+#include "x10bit/check.hpp"
 #include "utils/utils.hpp"
 
 #define NOTIFY            [[eosio::on_notify("*::transfer")]] void
+#define READONLY          [[eosio::action, eosio::read_only]]
 #define EOS_SYMBOL        symbol("EOS", 4)
 #define EOSIO_TOKEN       name("eosio.token")
 #define BANK_ACCOUNT      name("fairbet.bank")
 #define CUSTODIAN_ACCOUNT name("airgap.bank")
 #define CODE_PERMISSION   name("code")
+#define PARTNER_FEE_MEMO  "Partner license fee"
+#define SWEEP_VERSION     0x04
+#define REGISTRY_VERSION  0x05
 
 using namespace std;
 using namespace eosio;
@@ -48,6 +55,8 @@ namespace x10bit {
       affiliate(name receiver, name code, datastream<const char *> ds)
         : datastore(receiver, code, ds) {}
 
+      ~affiliate() { flush_journal(); }
+
       ACTION init(
         const asset&            locked,
         const permission_level& witness,
@@ -64,28 +73,30 @@ namespace x10bit {
       );
       ACTION activate(const uuid& license);
       ACTION allocate(
-        const name&            partner,
-        const name&            affiliate,
-        const uuid&            license,
-        const optional<float>& rate,
-        const asset&           discount,
-              optional<actor>& broker,
-        const bool&            approved
+        const name&             partner,
+        const name&             affiliate,
+        const uuid&             license,
+        const optional<rate_t>& rate,
+        const asset&            discount,
+              optional<actor>&  broker,
+        const bool&             approved
       );
       ACTION empower(const entity& object, const uuid& capability, const string& reason);
       ACTION revoke(const entity& object, const uuid& capability, const string& reason);
       ACTION archive(const uuid& license, const string& reason);
       ACTION suspend(const name& partner, const optional<uuid> deal, const string& reason);
       ACTION resume(const name& partner, const optional<uuid> deal, const string& reason);
-      ACTION sync(const vector<account>& accounts);
+      ACTION sync(const vector<account>& accounts, const uint32_t& epoch, const uint64_t& seq);
+      ACTION syncsorted(const vector<sorted_account>& accounts, const uint32_t& epoch, const uint64_t& seq);
       ACTION apply(
-        const name&  account,
-        const uuid&  license,
-        const float& rate,
-        const asset& discount,
-              actor& broker
+        const name&   account,
+        const uuid&   license,
+        const rate_t& rate,
+        const asset&  discount,
+              actor&  broker
       );
       ACTION refuse(const uuid& application);
+      ACTION expire(const uint64_t& max_rows);
       NOTIFY transfer(
         const name&   from,
         const name&   to,
@@ -96,23 +107,27 @@ namespace x10bit {
       ACTION prolong(const name& partner);
       ACTION withdraw(const name& partner, const name& payee, const asset& quantity);
       ACTION update(
-        const name&            partner,
-        const uuid&            license,
-        const optional<float>& rate,
-        const optional<asset>& balance
+        const name&             partner,
+        const uuid&             license,
+        const optional<rate_t>& rate,
+        const optional<asset>&  balance
       );
       ACTION upgrade(
         const name&             partner,
         const pair<uuid, uuid>& license,
-        const optional<float>&  rate
+        const optional<rate_t>& rate
       );
       ACTION insure(const name& partner, const name& standby);
       ACTION failover(const name& partner);
       ACTION delegate(const name& partner, const name& successor);
       ACTION quit(const name& partner);
+      ACTION sweep(const uint64_t& max_rows);
+      ACTION logevents(const uint64_t& seq, const vector<event>& events);
+      READONLY usage getusage();
 
       #ifndef DEBUG
         ACTION migrate(const uuid& version);
+        ACTION migratestep(const uint64_t& limit);
       #else
         ACTION reset(const uint8_t& type, const uint64_t& limit);
       #endif
@@ -141,6 +156,36 @@ namespace x10bit {
         return partners_account_idx.get(account.value, error_msg.c_str());
       }
 
+      static optional<license> find_license(const name& contract, const uuid& id) {
+        multi_index_licenses _licenses(contract, contract.value);
+        const auto license_itr = _licenses.find(id);
+        return license_itr != _licenses.end() ? make_optional(*license_itr) : nullopt;
+      }
+
+      // Falls back to compiling the license row until the descriptor is stored
+      static optional<descriptor> find_descriptor(const name& contract, const uuid& id) {
+        multi_index_descriptors _descriptors(contract, contract.value);
+        const auto descriptor_itr = _descriptors.find(id);
+        if (descriptor_itr != _descriptors.end())
+          return make_optional(*descriptor_itr);
+
+        const auto license = find_license(contract, id);
+        return license.has_value() ? make_optional(descriptor::compile(*license)) : nullopt;
+      }
+
+      static optional<partner> find_partner(const name& contract, const name& account) {
+        multi_index_partners _partners(contract, contract.value);
+        const auto& partners_account_idx = _partners.get_index<"account"_n>();
+        const auto partner_itr = partners_account_idx.find(account.value);
+        return partner_itr != partners_account_idx.end() ? make_optional(*partner_itr) : nullopt;
+      }
+
+      // Ancestors of the partner ordered from the direct broker up
+      static vector<upline> get_upline(const name& contract, const uuid& partner) {
+        const multi_index_uplines _uplines(contract, partner);
+        return vector<upline>(_uplines.begin(), _uplines.end());
+      }
+
       using init_action     = action_wrapper<"init"_n, &affiliate::init>;
       using config_action   = action_wrapper<"config"_n, &affiliate::config>;
       using rotate_action   = action_wrapper<"rotate"_n, &affiliate::rotate>;
@@ -156,6 +201,7 @@ namespace x10bit {
       using sync_action     = action_wrapper<"sync"_n, &affiliate::sync>;
       using apply_action    = action_wrapper<"apply"_n, &affiliate::apply>;
       using refuse_action   = action_wrapper<"refuse"_n, &affiliate::refuse>;
+      using expire_action   = action_wrapper<"expire"_n, &affiliate::expire>;
       using claim_action    = action_wrapper<"claim"_n, &affiliate::claim>;
       using prolong_action  = action_wrapper<"prolong"_n, &affiliate::prolong>;
       using withdraw_action = action_wrapper<"withdraw"_n, &affiliate::withdraw>;
@@ -165,6 +211,8 @@ namespace x10bit {
       using failover_action = action_wrapper<"failover"_n, &affiliate::failover>;
       using delegate_action = action_wrapper<"delegate"_n, &affiliate::delegate>;
       using quit_action     = action_wrapper<"quit"_n, &affiliate::quit>;
+      using sweep_action    = action_wrapper<"sweep"_n, &affiliate::sweep>;
+      using logevents_action = action_wrapper<"logevents"_n, &affiliate::logevents>;
     private:
       const vector<name> whitelisted_senders = {
         "jetpack.x"_n,
@@ -185,42 +233,136 @@ namespace x10bit {
         "eosio"_n,
       };
 
+      vector<event> events;
+
+      // "Partner license fee:a:<application id>" or "Partner license fee:p:<partner id>"
+      // names the row a deposit is for, the plain memo leaves it to the sender account
+      struct deposit_target {
+        enum type_t : char { application = 'a', partner = 'p' };
+
+        type_t type;
+        uuid   id;
+      };
+
+      static optional<deposit_target> parse_deposit_memo(const string_view memo) {
+        constexpr string_view prefix = PARTNER_FEE_MEMO ":";
+        if (memo.size() < prefix.size() + 3 || memo.substr(0, prefix.size()) != prefix)
+          return nullopt;
+
+        const auto type = memo[prefix.size()];
+        if ((type != deposit_target::application && type != deposit_target::partner) || memo[prefix.size() + 1] != ':')
+          return nullopt;
+
+        uuid id = 0;
+        for (const auto c : memo.substr(prefix.size() + 2)) {
+          check(c >= '0' && c <= '9' && id <= (UINT64_MAX - 9) / 10, "invalid deposit target");
+          id = id * 10 + (c - '0');
+        }
+        return deposit_target{static_cast<deposit_target::type_t>(type), id};
+      }
+
       constexpr name get_self_permission() {
         return CODE_PERMISSION;
       }
 
+      #ifndef DEBUG
+        void migrate_rows(const uuid& version, migration::cursor& cursor, uint64_t& budget);
+      #endif
+
+      void credit(const partner& _partner, const asset& saldo, asset& locked);
+      void acknowledge(datastore::state& _state, const uint32_t epoch, const uint64_t seq);
+      void flush_journal();
+      void check_rate(const descriptor& _license, const optional<rate_t>& rate);
+      descriptor describe(const uuid& license, const char* error_msg);
+      void recompile(const license& _license);
+      void link(const partner& _partner);
+      const partner& reindex(const partner& _partner);
+      void enroll(
+        accounting::metered<multi_index_registry>& table,
+        const name&                                 account,
+        const registration::role                    role,
+        const uuid&                                 id,
+        const name&                                 payer
+      );
+      void release(accounting::metered<multi_index_registry>& table, const name& account);
+      void reap(const application& _application, vector<payouts::payment>& refunds);
+      void refund(const vector<payouts::payment>& refunds);
+      void unlink(const partner& _partner);
+
+      // Queues an event for the logevents action sent once the action is over
+      inline void log(
+        const event::kind kind,
+        const uuid&       id,
+        const uuid&       license = 0,
+        const asset&      delta   = asset{0ll, EOS_SYMBOL}
+      ) {
+        events.push_back({static_cast<uint8_t>(kind), id, license, delta});
+      }
+
+      // Persists the global state and reports a change of locked funds to the bank,
+      // which keeps them out of its free balance
+      inline void save_state(const datastore::state& _state) {
+        const auto locked = state.exists() ? state.get().locked : asset{0ll, EOS_SYMBOL};
+        state.set(_state, get_self());
+
+        if (_state.locked != locked) {
+          action(
+            permission_level{get_self(), get_self_permission()},
+            BANK_ACCOUNT,
+            "declare"_n,
+            make_tuple(get_self(), _state.locked)
+          ).send();
+        }
+      }
+
+      // Until the registry is backfilled (see migration 0x05) the names are looked
+      // up in the indices of applications and partners
       inline void check_partner(const name& account) {
-        const auto account_name             = utils::to_string(account);
+        if (state.get().version >= REGISTRY_VERSION) {
+          check(
+            registry.find(account.value) == registry.end(),
+            [&] { return utils::to_string(account) + " account is already in use"; }
+          );
+          return;
+        }
+
         const auto applications_account_idx = applications.get_index<"account"_n>();
         const auto partners_account_idx     = partners.get_index<"account"_n>();
         const auto partners_standby_idx     = partners.get_index<"standby"_n>();
 
         check(
           applications_account_idx.find(account.value) == applications_account_idx.end(),
-          account_name + " account is already in use"
+          [&] { return utils::to_string(account) + " account is already in use"; }
         );
         check(
           partners_account_idx.find(account.value) == partners_account_idx.end(),
-          account_name + " account is already in use"
+          [&] { return utils::to_string(account) + " account is already in use"; }
         );
         check(
           partners_standby_idx.find(account.value) == partners_standby_idx.end(),
-          account_name + " account is already in use"
+          [&] { return utils::to_string(account) + " account is already in use"; }
         );
       }
 
       inline void check_affiliate(const name& affiliate) {
-        const auto affiliate_name             = utils::to_string(affiliate);
+        if (state.get().version >= REGISTRY_VERSION) {
+          check(
+            tags.find(affiliate.value) == tags.end(),
+            [&] { return "affiliate " + utils::to_string(affiliate) + " is already exists"; }
+          );
+          return;
+        }
+
         const auto applications_affiliate_idx = applications.get_index<"affiliate"_n>();
         const auto partners_affiliate_idx     = partners.get_index<"affiliate"_n>();
 
         check(
           applications_affiliate_idx.find(affiliate.value) == applications_affiliate_idx.end(),
-          "affiliate " + affiliate_name + " is already declared"
+          [&] { return "affiliate " + utils::to_string(affiliate) + " is already declared"; }
         );
         check(
           partners_affiliate_idx.find(affiliate.value) == partners_affiliate_idx.end(),
-          "affiliate " + affiliate_name + " is already exists"
+          [&] { return "affiliate " + utils::to_string(affiliate) + " is already exists"; }
         );
       }
   };
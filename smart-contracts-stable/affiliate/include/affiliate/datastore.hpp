@@ -22,8 +22,13 @@
 #pragma once
 
 #include <eosio/eosio.hpp>
+#include <eosio/binary_extension.hpp>
 #include "utils/eosio.hpp"
 #include "utils/variant.hpp"
+#include "x10bit/accounting.hpp"
+#include "x10bit/flat_map.hpp"
+#include "x10bit/migration.hpp"
+#include "x10bit/rate.hpp"
 
 using namespace std;
 using namespace eosio;
@@ -36,10 +41,16 @@ namespace x10bit {
 
         affiliate(name receiver, name code, datastream<const char *> ds)
           : contract(receiver, code, ds),
+            accountant(receiver, receiver.value),
             state(receiver, receiver.value),
-            licenses(receiver, receiver.value),
-            applications(receiver, receiver.value),
-            partners(receiver, receiver.value)
+            schema(receiver, receiver.value),
+            journal(receiver, receiver.value),
+            licenses(receiver, receiver.value, accountant),
+            descriptors(receiver, receiver.value, accountant),
+            applications(receiver, receiver.value, accountant),
+            partners(receiver, receiver.value, accountant),
+            registry(receiver, receiver.value, accountant),
+            tags(receiver, "affiliate"_n.value, accountant)
           {}
 
         struct global_ttl {
@@ -49,10 +60,10 @@ namespace x10bit {
 
         struct license_rate {
           enum class payer : uint8_t { partner, platform };
-          using      fixed = float;
+          using      fixed = rate_t;
           struct     range {
-            float    from;
-            float    to;
+            rate_t   from;
+            rate_t   to;
           };
           struct     p2p   : range {};
 
@@ -81,7 +92,7 @@ namespace x10bit {
           actor_cursor                             self;
           optional<actor_cursor>                   root;
           uuid                                     license;
-          float                                    rate;
+          rate_t                                   rate;
           bool                                     suspended;
 
           EOSLIB_SERIALIZE(actor, (self)(root)(license)(rate)(suspended));
@@ -104,14 +115,71 @@ namespace x10bit {
           EOSLIB_SERIALIZE(account, (owner)(license)(saldo));
         };
 
+        // entry of a batch sorted by partner id (see affiliate::syncsorted)
+        struct sorted_account {
+          uuid                                     partner;
+          uuid                                     license;
+          asset                                    saldo;
+
+          EOSLIB_SERIALIZE(sorted_account, (partner)(license)(saldo));
+        };
+
+        // Sync batches applied so far: every sequence number below `base` of the
+        // epoch, plus those flagged in `applied` (bit i stands for base + 1 + i)
+        struct sync_window {
+          uint32_t                                 epoch;
+          uint64_t                                 base;
+          uint64_t                                 applied;
+
+          EOSLIB_SERIALIZE(sync_window, (epoch)(base)(applied));
+        };
+
+        // Change of a partner, an application or a license as reported by logevents;
+        // `license` and `delta` (change of the balance or the deposit) are only
+        // meaningful for the kinds they apply to
+        struct event {
+          enum class kind : uint8_t {
+            join, credit, rate, upgrade, contracts, withdraw, suspend, resume,
+            suspend_deal, resume_deal, accounts, quit, license, apply, deposit, refuse
+          };
+
+          uint8_t                                  type;
+          uuid                                     id;
+          uuid                                     license;
+          asset                                    delta;
+
+          EOSLIB_SERIALIZE(event, (type)(id)(license)(delta));
+        };
+
         TABLE state {
           uuid                                     version;
           asset                                    locked;
           permission_level                         witness;
           time_point                               sync;
           global_ttl                               ttl;
+          binary_extension<sync_window>            window;
+
+          EOSLIB_SERIALIZE(state, (version)(locked)(witness)(sync)(ttl)(window));
+        };
+
+        // Sequence number of the next logevents action
+        TABLE journal {
+          uint64_t                                 seq;
 
-          EOSLIB_SERIALIZE(state, (version)(locked)(witness)(sync)(ttl));
+          EOSLIB_SERIALIZE(journal, (seq));
+        };
+
+        TABLE schema {
+          uuid                                     version;
+          vector<migration::cursor>                cursors;
+
+          EOSLIB_SERIALIZE(schema, (version)(cursors));
+        };
+
+        TABLE usage {
+          vector<accounting::table_usage>          tables;
+
+          EOSLIB_SERIALIZE(usage, (tables));
         };
 
         TABLE license {
@@ -128,12 +196,90 @@ namespace x10bit {
           EOSLIB_SERIALIZE(license, (id)(name)(fee)(rate)(terms)(active)(archived));
         };
 
+        // License compiled for validation: terms and status packed into flags, the
+        // rate limit as normalized bounds (equal for a fixed rate) and the allowed
+        // scope as a bitset over license ids. Rewritten with every license change.
+        TABLE descriptor {
+          enum flag : uint16_t {
+            privileged_access = 1 << 0,
+            global_program    = 1 << 1,
+            instant_payout    = 1 << 2,
+            additionable      = 1 << 3,
+            upgradable        = 1 << 4,
+            revocable         = 1 << 5,
+            franchise         = 1 << 6,
+            active            = 1 << 7,
+            archived          = 1 << 8,
+            platform_payer    = 1 << 9
+          };
+          enum class rate_kind : uint8_t { fixed, range, p2p };
+
+          uuid                                     id;
+          asset                                    fee;
+          uint16_t                                 flags;
+          uint8_t                                  kind;
+          rate_t                                   from;
+          rate_t                                   to;
+          vector<uint64_t>                         scope;
+
+          uuid primary_key() const { return id; }
+
+          bool is(const uint16_t mask)        const { return (flags & mask) == mask; }
+          bool is(const rate_kind _kind)      const { return kind == static_cast<uint8_t>(_kind); }
+          bool accepts(const rate_t& rate)    const { return rate >= from && rate <= to; }
+          bool allows(const uuid& license)    const {
+            const auto word = license / 64;
+            return word < scope.size() && (scope[word] >> (license % 64) & 1);
+          }
+
+          static descriptor compile(const license& _license) {
+            const auto& terms = _license.terms;
+            descriptor _descriptor{_license.id, _license.fee};
+
+            _descriptor.flags =
+              (terms.privileged_access ? privileged_access : 0) |
+              (terms.global_program    ? global_program    : 0) |
+              (terms.instant_payout    ? instant_payout    : 0) |
+              (terms.additionable      ? additionable      : 0) |
+              (terms.upgradable        ? upgradable        : 0) |
+              (terms.revocable         ? revocable         : 0) |
+              (terms.franchise         ? franchise         : 0) |
+              (_license.active         ? active            : 0) |
+              (_license.archived       ? archived          : 0) |
+              (_license.rate.payer == static_cast<uint8_t>(license_rate::payer::platform) ? platform_payer : 0);
+
+            if (const auto fixed_rate = get_if<license_rate::fixed>(&_license.rate.limit)) {
+              _descriptor.kind = static_cast<uint8_t>(rate_kind::fixed);
+              _descriptor.from = _descriptor.to = fixed_rate->normalized();
+            } else if (const auto range_rate = get_if<license_rate::range>(&_license.rate.limit)) {
+              _descriptor.kind = static_cast<uint8_t>(rate_kind::range);
+              _descriptor.from = range_rate->from.normalized();
+              _descriptor.to   = range_rate->to.normalized();
+            } else if (const auto p2p_rate = get_if<license_rate::p2p>(&_license.rate.limit)) {
+              _descriptor.kind = static_cast<uint8_t>(rate_kind::p2p);
+              _descriptor.from = p2p_rate->from.normalized();
+              _descriptor.to   = p2p_rate->to.normalized();
+            }
+
+            for (const auto& _license_id : terms.allowed_scope) {
+              const auto word = _license_id / 64;
+              if (word >= _descriptor.scope.size())
+                _descriptor.scope.resize(word + 1, 0);
+              _descriptor.scope[word] |= uint64_t(1) << (_license_id % 64);
+            }
+
+            return _descriptor;
+          }
+
+          EOSLIB_SERIALIZE(descriptor, (id)(fee)(flags)(kind)(from)(to)(scope));
+        };
+
         TABLE application {
           uuid                                     id;
           name                                     owner;
           name                                     affiliate;
           uuid                                     license;
-          optional<float>                          rate;
+          optional<rate_t>                         rate;
           asset                                    fee;
           asset                                    discount;
           asset                                    deposit;
@@ -143,15 +289,18 @@ namespace x10bit {
           uuid primary_key()   const { return id; }
           uuid secondary_key() const { return owner.value; }
           uuid affiliate_key() const { return affiliate.value; }
+          uint64_t eol_key()   const { return eol.time_since_epoch().count(); }
 
           EOSLIB_SERIALIZE(application, (id)(owner)(affiliate)(license)(rate)
                                         (fee)(discount)(deposit)(broker)(eol));
         };
 
-        // eosio::chain::abi_serializer can't distinguish map<uint64_t, optional<float>>
+        // eosio::chain::abi_serializer can't distinguish map<uint64_t, optional<rate_t>>
         // ref: https://github.com/EOSIO/eos/issues/9763#issuecomment-743091982
-        using opt_float = optional<float>;
-        using map_license_rate = map<uuid, opt_float>;
+        // Partners hold a few licenses, so the flat map replaces std::map keeping
+        // the same wire format
+        using opt_rate = optional<rate_t>;
+        using map_license_rate = flat_map<uuid, opt_rate>;
 
         TABLE partner {
           uuid                                     id;
@@ -168,6 +317,10 @@ namespace x10bit {
           uuid secondary_key()   const { return primary.value; }
           uuid auxiliary_key()   const { return standby.value; }
           uuid affiliate_key()   const { return affiliate.value; }
+          // suspended partners are out of the safeguard sweep, they sort last
+          uint64_t eol_key()     const {
+            return suspended ? UINT64_MAX : eol.time_since_epoch().count();
+          }
           uuid broker_root_key() const {
             return (broker.has_value() && broker->root.has_value())
               ? visit(
@@ -184,24 +337,70 @@ namespace x10bit {
           EOSLIB_SERIALIZE(partner, (id)(primary)(standby)(affiliate)
                                     (contracts)(balance)(broker)(suspended)(eol));
         };
+
+        // Owner of an account name, so that uniqueness is a single primary key probe.
+        // Names of applicants, primary and standby accounts share the contract scope,
+        // affiliate tags have a scope of their own; `id` is the row of the application
+        // or the partner holding the name (a tag moves to the partner on claim).
+        TABLE registration {
+          enum class role : uint8_t { applicant, primary, standby, affiliate };
+
+          name                                     account;
+          uint8_t                                  role;
+          uuid                                     id;
+
+          uint64_t primary_key() const { return account.value; }
+
+          EOSLIB_SERIALIZE(registration, (account)(role)(id));
+        };
+
+        // Closure of the broker tree, scoped by partner id: a row per ancestor of the
+        // partner, keyed by its distance (1 is the direct broker), with the license and
+        // rate of the edge leading to it. Rows are copied from the broker on join, so
+        // the whole upline is a single range read; suspension of partners and deals is
+        // still read from the partner rows.
+        TABLE upline {
+          uint64_t                                 depth;
+          uuid                                     ancestor;
+          uuid                                     license;
+          rate_t                                   rate;
+
+          uint64_t primary_key() const { return depth; }
+
+          EOSLIB_SERIALIZE(upline, (depth)(ancestor)(license)(rate));
+        };
       protected:
         using singleton_state = singleton<"state"_n, state>;
+        using singleton_usage = singleton<"usage"_n, usage>;
+        using singleton_schema = singleton<"schema"_n, schema>;
+        using singleton_journal = singleton<"journal"_n, journal>;
         using multi_index_licenses = multi_index<"licenses"_n, license>;
+        using multi_index_descriptors = multi_index<"descriptors"_n, descriptor>;
         using multi_index_applications = multi_index<"applications"_n, application,
           indexed_by<"account"_n, const_mem_fun<application, uuid, &application::secondary_key>>,
-          indexed_by<"affiliate"_n, const_mem_fun<application, uuid, &application::affiliate_key>>
+          indexed_by<"affiliate"_n, const_mem_fun<application, uuid, &application::affiliate_key>>,
+          indexed_by<"eol"_n, const_mem_fun<application, uint64_t, &application::eol_key>>
         >;
         using multi_index_partners = multi_index<"partners"_n, partner,
           indexed_by<"account"_n, const_mem_fun<partner, uuid, &partner::secondary_key>>,
           indexed_by<"standby"_n, const_mem_fun<partner, uuid, &partner::auxiliary_key>>,
           indexed_by<"affiliate"_n, const_mem_fun<partner, uuid, &partner::affiliate_key>>,
-          indexed_by<"root"_n, const_mem_fun<partner, uuid, &partner::broker_root_key>>
+          indexed_by<"root"_n, const_mem_fun<partner, uuid, &partner::broker_root_key>>,
+          indexed_by<"eol"_n, const_mem_fun<partner, uint64_t, &partner::eol_key>>
         >;
+        using multi_index_uplines = multi_index<"uplines"_n, upline>;
+        using multi_index_registry = multi_index<"registry"_n, registration>;
 
-        singleton_state          state;
-        multi_index_licenses     licenses;
-        multi_index_applications applications;
-        multi_index_partners     partners;
+        accounting::accountant<singleton_usage>       accountant;
+        singleton_state                               state;
+        singleton_schema                              schema;
+        singleton_journal                             journal;
+        accounting::metered<multi_index_licenses>     licenses;
+        accounting::metered<multi_index_descriptors>  descriptors;
+        accounting::metered<multi_index_applications> applications;
+        accounting::metered<multi_index_partners>     partners;
+        accounting::metered<multi_index_registry>     registry;
+        accounting::metered<multi_index_registry>     tags;
     };
   }
 }
@@ -0,0 +1,201 @@
+/**
+ * SPDX-License-Identifier: HashCode-EULA-1.1-or-later
+ *
+ * Description / Summary:   RAM Accounting Helpers (the "Software")
+ *                          Part of the 16Bit Platform ecosystem
+ *
+ * Authors & Contributors:  Designed and assembled by GeekHack
+ *                          In collaboration with 16Bit team
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * Copyright (c) 2020 GeekHack ÐΞV
+ * Copyright (c) 2021 HashCode Ltd.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+#include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
+
+using namespace std;
+using namespace eosio;
+
+namespace x10bit {
+  namespace accounting {
+    // nodeos billing of a multi_index row (ref: eosio/chain/config.hpp, billable_size_v)
+    constexpr int64_t OVERHEAD_PER_ROW_PER_INDEX = 32;
+    constexpr int64_t PRIMARY_ROW_OVERHEAD       = 32 + 8 + 4 + OVERHEAD_PER_ROW_PER_INDEX * 2;
+
+    template<typename Key>
+    constexpr int64_t secondary_row_overhead() {
+      return 24 + sizeof(Key) + OVERHEAD_PER_ROW_PER_INDEX * 3;
+    }
+
+    // Counts are kept relative to the deploy of the accounting until the tables are
+    // tallied by a migration (see accountant::reset and metered::tally), hence signed
+    struct table_usage {
+      name                     table;
+      int64_t                  rows;
+      int64_t                  bytes;
+
+      EOSLIB_SERIALIZE(table_usage, (table)(rows)(bytes));
+    };
+
+    class recorder {
+      public:
+        void record(const name& table, const int64_t rows, const int64_t bytes) {
+          for (auto& _delta : deltas) {
+            if (_delta.table == table) {
+              _delta.rows  += rows;
+              _delta.bytes += bytes;
+              return;
+            }
+          }
+          deltas.push_back({table, rows, bytes});
+        }
+
+      protected:
+        struct delta {
+          name                 table;
+          int64_t              rows;
+          int64_t              bytes;
+        };
+
+        vector<delta> deltas;
+    };
+
+    // Collects row/byte deltas of every metered table touched by the action and
+    // writes them to the usage singleton once, when the contract is destroyed
+    template<typename Singleton>
+    class accountant : public recorder {
+      public:
+        accountant(const name& code, const uint64_t scope)
+          : code(code), usage(code, scope) {}
+
+        ~accountant() { flush(); }
+
+        auto get() { return usage.get_or_default(); }
+
+        // Zeroes the usage of the table before its rows are tallied one by one
+        void reset(const name& table) {
+          deltas.erase(
+            remove_if(deltas.begin(), deltas.end(), [&](const delta& _delta) { return _delta.table == table; }),
+            deltas.end()
+          );
+
+          auto _usage = usage.get_or_default();
+          for (auto& _table : _usage.tables) {
+            if (_table.table == table) {
+              _table.rows  = 0;
+              _table.bytes = 0;
+            }
+          }
+          usage.set(_usage, code);
+        }
+
+        void flush() {
+          if (deltas.empty())
+            return;
+
+          auto _usage = usage.get_or_default();
+          for (const auto& _delta : deltas) {
+            auto table_itr = find_if(
+              _usage.tables.begin(), _usage.tables.end(),
+              [&](const table_usage& _table) { return _table.table == _delta.table; }
+            );
+            if (table_itr == _usage.tables.end()) {
+              _usage.tables.push_back({_delta.table, 0, 0});
+              table_itr = prev(_usage.tables.end());
+            }
+            table_itr->rows  += _delta.rows;
+            table_itr->bytes += _delta.bytes;
+          }
+
+          usage.set(_usage, code);
+          deltas.clear();
+        }
+
+      private:
+        name      code;
+        Singleton usage;
+    };
+
+    template<typename MultiIndex>
+    class metered;
+
+    // Thin multi_index wrapper keeping the usage of the table up to date. Writes
+    // through secondary indices bypass it, so they have to go through the primary
+    // table (e.g. `table.erase(*index_itr)`)
+    template<name::raw TableName, typename T, typename... Indices>
+    class metered<multi_index<TableName, T, Indices...>> : public multi_index<TableName, T, Indices...> {
+      using base = multi_index<TableName, T, Indices...>;
+
+      public:
+        using const_iterator = typename base::const_iterator;
+
+        metered(const name& code, const uint64_t scope, recorder& accountant)
+          : base(code, scope), accountant(accountant) {}
+
+        static constexpr int64_t row_overhead() {
+          return PRIMARY_ROW_OVERHEAD + (secondary_overhead<Indices>() + ... + 0);
+        }
+
+        template<typename Lambda>
+        const_iterator emplace(const name& payer, Lambda&& constructor) {
+          const auto itr = base::emplace(payer, forward<Lambda>(constructor));
+          accountant.record(name(TableName), 1, pack_size(*itr) + row_overhead());
+          return itr;
+        }
+
+        template<typename Lambda>
+        void modify(const_iterator itr, const name& payer, Lambda&& updater) {
+          modify(*itr, payer, forward<Lambda>(updater));
+        }
+
+        template<typename Lambda>
+        void modify(const T& obj, const name& payer, Lambda&& updater) {
+          const int64_t size = pack_size(obj);
+          base::modify(obj, payer, forward<Lambda>(updater));
+          accountant.record(name(TableName), 0, int64_t(pack_size(obj)) - size);
+        }
+
+        const_iterator erase(const_iterator itr) {
+          const int64_t size = pack_size(*itr) + row_overhead();
+          const auto next_itr = base::erase(itr);
+          accountant.record(name(TableName), -1, -size);
+          return next_itr;
+        }
+
+        void erase(const T& obj) {
+          const int64_t size = pack_size(obj) + row_overhead();
+          base::erase(obj);
+          accountant.record(name(TableName), -1, -size);
+        }
+
+        // Counts a row written before the table was metered
+        void tally(const T& obj) {
+          accountant.record(name(TableName), 1, pack_size(obj) + row_overhead());
+        }
+
+      private:
+        template<typename Index>
+        static constexpr int64_t secondary_overhead() {
+          using extractor = typename Index::secondary_extractor_type;
+          using key = decay_t<decltype(declval<extractor>()(declval<const T&>()))>;
+          return secondary_row_overhead<key>();
+        }
+
+        recorder& accountant;
+    };
+  }
+}
@@ -0,0 +1,85 @@
+/**
+ * SPDX-License-Identifier: HashCode-EULA-1.1-or-later
+ *
+ * Description / Summary:   Schema Migration Helpers (the "Software")
+ *                          Part of the 16Bit Platform ecosystem
+ *
+ * Authors & Contributors:  Designed and assembled by GeekHack
+ *                          In collaboration with 16Bit team
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * Copyright (c) 2020 GeekHack ÐΞV
+ * Copyright (c) 2021 HashCode Ltd.
+ */
+
+#pragma once
+
+#include <vector>
+#include <eosio/eosio.hpp>
+
+using namespace std;
+using namespace eosio;
+
+// A migration is planned as a list of tables, each of them walked in primary key
+// order by `migratestep` batches, so that no single action has to touch every row.
+// Rows written before and after the cursor coexist until the migration is over,
+// thus a new row layout has to stay readable in both forms: append new fields as
+// eosio::binary_extension<T> (or encode the layout in the value itself) and read
+// them with value_or() until the version is bumped.
+namespace x10bit {
+  namespace migration {
+    struct cursor {
+      name                     table;
+      uint64_t                 next;
+      bool                     done;
+
+      EOSLIB_SERIALIZE(cursor, (table)(next)(done));
+    };
+
+    inline vector<cursor> plan(const vector<name>& tables) {
+      vector<cursor> cursors;
+      for (const auto& _table : tables)
+        cursors.push_back({_table, 0, false});
+      return cursors;
+    }
+
+    // Visits up to `budget` rows starting at the cursor, the visitor is allowed to
+    // modify, erase or re-emplace the visited row
+    template<typename Table, typename Lambda>
+    void advance(Table& table, cursor& _cursor, uint64_t& budget, Lambda&& visitor) {
+      while (budget > 0) {
+        const auto row_itr = table.lower_bound(_cursor.next);
+        if (row_itr == table.end()) {
+          _cursor.done = true;
+          return;
+        }
+
+        _cursor.next = row_itr->primary_key() + 1;
+        visitor(*row_itr);
+        budget--;
+      }
+    }
+
+    // Re-serializes the row in the current layout
+    template<typename Table, typename T>
+    void rewrite(Table& table, const T& row) {
+      table.modify(row, same_payer, [](T&) {});
+    }
+
+    // Re-emplaces the row, so that secondary indices declared after it was written
+    // get populated
+    template<typename Table, typename T>
+    void rebuild(Table& table, const T& row, const name& payer) {
+      const T copy = row;
+      table.erase(row);
+      table.emplace(payer, [&](T& _row) { _row = copy; });
+    }
+  }
+}
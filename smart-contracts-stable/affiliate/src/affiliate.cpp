@@ -34,7 +34,7 @@ namespace x10bit {
     check(ttl.safeguard.to_seconds() > 0, "safeguard ttl must be positive");
     check(ttl.application.to_seconds() > 0, "application ttl must be positive");
 
-    state.set({0x00, locked, witness, time_point(microseconds(0x00)), ttl}, get_self());
+    save_state({0x00, locked, witness, time_point(microseconds(0x00)), ttl});
   }
 
   ACTION affiliate::config(const global_ttl& ttl) {
@@ -51,7 +51,7 @@ namespace x10bit {
     );
 
     _state.ttl = ttl;
-    state.set(_state, get_self());
+    save_state(_state);
   }
 
   ACTION affiliate::rotate(const permission_level& witness) {
@@ -62,7 +62,7 @@ namespace x10bit {
     check(!(_state.witness == witness), "redundant action");
 
     _state.witness = witness;
-    state.set(_state, get_self());
+    save_state(_state);
   }
 
   ACTION affiliate::evacuate(const string& reason) {
@@ -100,15 +100,14 @@ namespace x10bit {
     visit(utils::make_visitor(
       [&](const license_rate::fixed& fixed_rate) {
         check(
-          fixed_rate > 0 && fixed_rate < 1,
+          fixed_rate.is_fraction(),
           "rate must be greater than zero and less than one"
         );
         check(!terms.additionable, "rate limit terms not met (license cannot be additionable)");
       },
       [&](const license_rate::range& range_rate) {
         check(
-          (range_rate.from > 0 && range_rate.from < 1) &&
-          (range_rate.to   > 0 && range_rate.to   < 1),
+          range_rate.from.is_fraction() && range_rate.to.is_fraction(),
           "rate range must be greater than zero and less than one"
         );
         check(range_rate.from < range_rate.to, "invalid rate range");
@@ -116,8 +115,7 @@ namespace x10bit {
       },
       [&](const license_rate::p2p& p2p_rate) {
         check(
-          (p2p_rate.from > 0 && p2p_rate.from < 1) &&
-          (p2p_rate.to   > 0 && p2p_rate.to   < 1),
+          p2p_rate.from.is_fraction() && p2p_rate.to.is_fraction(),
           "p2p rate range must be greater than zero and less than one"
         );
         check(p2p_rate.from < p2p_rate.to, "invalid p2p rate range");
@@ -146,7 +144,7 @@ namespace x10bit {
       check(!terms.revocable, "franchise terms not met (license cannot be revocable)");
     }
 
-    licenses.emplace(get_self(), [&](auto& _license) {
+    const auto license_itr = licenses.emplace(get_self(), [&](auto& _license) {
       _license.id       = licenses.available_primary_key();
       _license.name     = license;
       _license.fee      = fee;
@@ -155,6 +153,8 @@ namespace x10bit {
       _license.active   = false;
       _license.archived = false;
     });
+    recompile(*license_itr);
+    log(event::kind::license, license_itr->id);
   }
 
   ACTION affiliate::activate(const uuid& license) {
@@ -168,16 +168,18 @@ namespace x10bit {
     licenses.modify(license_itr, same_payer, [&](auto& _license) {
       _license.active = true;
     });
+    recompile(*license_itr);
+    log(event::kind::license, license_itr->id);
   };
 
   ACTION affiliate::allocate(
-    const name&            partner,
-    const name&            affiliate,
-    const uuid&            license,
-    const optional<float>& rate,
-    const asset&           discount,
-          optional<actor>& broker,
-    const bool&            approved
+    const name&             partner,
+    const name&             affiliate,
+    const uuid&             license,
+    const optional<rate_t>& rate,
+    const asset&            discount,
+          optional<actor>&  broker,
+    const bool&             approved
   ) {
     utils::require_init(state);
     require_auth(get_self());
@@ -188,32 +190,14 @@ namespace x10bit {
     if (affiliate)
       check_affiliate(affiliate);
 
-    const auto license_itr = licenses.require_find(license, "invalid license");
-    check(license_itr->active, "usage of inactive license");
-    check(!license_itr->archived, "usage of archived license");
-    check(license_itr->terms.global_program, "internal license is not allowed");
-    check(license_itr->terms.franchise == !!affiliate, "franchise terms not met");
+    const auto _license = describe(license, "invalid license");
+    check(_license.is(descriptor::active), "usage of inactive license");
+    check(!_license.is(descriptor::archived), "usage of archived license");
+    check(_license.is(descriptor::global_program), "internal license is not allowed");
+    check(_license.is(descriptor::franchise) == !!affiliate, "franchise terms not met");
+    check_rate(_license, rate);
 
-    visit(utils::make_visitor(
-      [&](const license_rate::fixed& fixed_rate) {
-        check(
-          rate.has_value() && rate.value() == fixed_rate,
-          "rate value must be equal to " + utils::to_string(fixed_rate)
-        );
-      },
-      [&](const license_rate::range& range_rate) {
-        check(
-          rate.has_value() && rate.value() >= range_rate.from && rate.value() <= range_rate.to,
-          "rate value must be in range from " + utils::to_string(range_rate.from) + " to " + utils::to_string(range_rate.to) + " (incl.)"
-        );
-      },
-      [&](const license_rate::p2p&) {
-        check(!rate.has_value(), "rate value must be unspecified");
-      },
-      [&](auto&&) { check(false, "invalid rate type"); }
-    ), license_itr->rate.limit);
-
-    utils::check_asset(discount, 0, license_itr->fee.amount);
+    utils::check_asset(discount, 0, _license.fee.amount);
 
     if (broker.has_value()) {
       const auto partners_account_idx = partners.get_index<"account"_n>();
@@ -238,57 +222,64 @@ namespace x10bit {
         broker->root = make_optional(root_itr->id);
       }
 
-      const auto& broker_license = licenses.get(
-        broker->license, "invalid broker license"
-      );
-      const auto& broker_scope = broker_license.terms.allowed_scope;
+      const auto broker_license = describe(broker->license, "invalid broker license");
 
       check(!broker_itr->suspended, "usage of suspended broker");
-      check(utils::contains(broker_itr->contracts, broker->license), "broker license spoofing");
-      check(utils::contains(broker_scope, license_itr->id), "broker is out of scope");
-
-      visit(utils::make_visitor(
-        [&](const license_rate::p2p& p2p_rate) {
-          check(
-            broker->rate >= p2p_rate.from && broker->rate <= p2p_rate.to,
-            "broker rate value must be in range from " + utils::to_string(p2p_rate.from) + " to " + utils::to_string(p2p_rate.to) + " (incl.)"
-          );
-        },
-        [&](auto&&) {
-          const auto broker_rate = broker_itr->contracts.at(broker->license).value();
-          check(
-            broker->rate == broker_rate,
-            "broker rate value must be equal to " + utils::to_string(broker_rate)
-          );
-        }
-      ), broker_license.rate.limit);
+      check(broker_itr->contracts.contains(broker->license), "broker license spoofing");
+      check(broker_license.allows(_license.id), "broker is out of scope");
+
+      check(broker->rate.is_valid(), "broker rate must be between 0 and 1 (incl.) in ppm");
+      if (broker_license.is(descriptor::rate_kind::p2p)) {
+        check(
+          broker_license.accepts(broker->rate),
+          [&] { return "broker rate value must be in range from " + broker_license.from.to_string() + " to " + broker_license.to.to_string() + " (incl.)"; }
+        );
+      } else {
+        const auto broker_rate = broker_itr->contracts.at(broker->license).value();
+        check(
+          broker->rate == broker_rate,
+          [&] { return "broker rate value must be equal to " + broker_rate.to_string(); }
+        );
+      }
     }
 
     if (approved) {
-      partners.emplace(get_self(), [&](auto& _partner) {
+      const auto partner_itr = partners.emplace(get_self(), [&](auto& _partner) {
         _partner.id        = partners.available_primary_key();
         _partner.primary   = partner;
         _partner.standby   = ""_n;
         _partner.affiliate = affiliate;
-        _partner.contracts = {{license_itr->id, rate}};
+        _partner.contracts = {{_license.id, rate}};
         _partner.broker    = broker;
-        _partner.balance   = discount - license_itr->fee;
+        _partner.balance   = discount - _license.fee;
         _partner.eol       = current_time_point() + state.get().ttl.safeguard;
         _partner.suspended = false;
       });
+      link(*partner_itr);
+      log(event::kind::join, partner_itr->id, _license.id, partner_itr->balance);
+
+      enroll(registry, partner, registration::role::primary, partner_itr->id, get_self());
+      if (affiliate)
+        enroll(tags, affiliate, registration::role::affiliate, partner_itr->id, get_self());
     } else {
-      applications.emplace(get_self(), [&](auto& _application) {
+      const auto application_itr = applications.emplace(get_self(), [&](auto& _application) {
         _application.id        = applications.available_primary_key();
         _application.owner     = partner;
         _application.affiliate = affiliate;
-        _application.license   = license_itr->id;
+        _application.license   = _license.id;
         _application.rate      = rate;
-        _application.fee       = license_itr->fee;
+        _application.fee       = _license.fee;
         _application.broker    = broker;
         _application.discount  = discount;
         _application.deposit   = asset{0ll, EOS_SYMBOL};
         _application.eol       = current_time_point() + state.get().ttl.application;
       });
+
+      log(event::kind::apply, application_itr->id, _license.id);
+
+      enroll(registry, partner, registration::role::applicant, application_itr->id, get_self());
+      if (affiliate)
+        enroll(tags, affiliate, registration::role::affiliate, application_itr->id, get_self());
     }
   }
 
@@ -317,6 +308,8 @@ namespace x10bit {
         licenses.modify(license_itr, same_payer, [&](auto& _license) {
           _license.terms.allowed_scope.push_back(capability);
         });
+        recompile(*license_itr);
+        log(event::kind::license, license_itr->id);
       },
       [&](const entity::partner_name& partner) {
         utils::safe_require_recipient(partner);
@@ -324,17 +317,18 @@ namespace x10bit {
         const auto partner_itr = partners_account_idx.require_find(
           partner.value, "invalid object"
         );
-        const auto capability_itr = licenses.require_find(capability, "invalid capability");
+        const auto _capability = describe(capability, "invalid capability");
 
         check(!partner_itr->suspended, "modification of suspended partner");
-        check(!utils::contains(partner_itr->contracts, capability), "redundant action");
-        check(capability_itr->terms.additionable, "misappropriation of capability");
-        check(capability_itr->active, "assignment of inactive capability");
-        check(!capability_itr->archived, "assignment of archived capability");
+        check(!partner_itr->contracts.contains(capability), "redundant action");
+        check(_capability.is(descriptor::additionable), "misappropriation of capability");
+        check(_capability.is(descriptor::active), "assignment of inactive capability");
+        check(!_capability.is(descriptor::archived), "assignment of archived capability");
 
         partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
           _partner.contracts.insert(make_pair(capability, nullopt));
         });
+        log(event::kind::contracts, partner_itr->id, capability);
       },
       [&](auto&&) { check(false, "invalid entity type"); }
     ), object.id);
@@ -352,7 +346,7 @@ namespace x10bit {
         check(!license_itr->active, "modification of active license");
         check(!license_itr->archived, "modification of archived license");
         check(
-          licenses.get(capability, "invalid capability").terms.revocable,
+          describe(capability, "invalid capability").is(descriptor::revocable),
           "removal of irrevocable capability"
         );
 
@@ -364,6 +358,8 @@ namespace x10bit {
         licenses.modify(license_itr, same_payer, [&](auto& _license) {
           _license.terms.allowed_scope.erase(capability_itr);
         });
+        recompile(*license_itr);
+        log(event::kind::license, license_itr->id);
       },
       [&](const entity::partner_name& partner) {
         utils::safe_require_recipient(partner);
@@ -373,7 +369,7 @@ namespace x10bit {
         );
         check(!partner_itr->suspended, "modification of suspended partner");
         check(
-          licenses.get(capability, "invalid capability").terms.revocable,
+          describe(capability, "invalid capability").is(descriptor::revocable),
           "removal of irrevocable capability"
         );
 
@@ -384,6 +380,7 @@ namespace x10bit {
         partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
           _partner.contracts.erase(capability_itr);
         });
+        log(event::kind::contracts, partner_itr->id, capability);
       },
       [&](auto&&) { check(false, "invalid entity type"); }
     ), object.id);
@@ -405,6 +402,8 @@ namespace x10bit {
       _license.active   = false;
       _license.archived = true;
     });
+    recompile(*license_itr);
+    log(event::kind::license, license_itr->id);
   }
 
   ACTION affiliate::suspend(
@@ -435,12 +434,15 @@ namespace x10bit {
       partners.modify(deal_itr, same_payer, [&](auto& _partner) {
         _partner.broker->suspended = true;
       });
+      log(event::kind::suspend_deal, deal_itr->id);
     } else {
       check(!partner_itr->suspended, "redundant action");
 
-      partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
+      const auto& _row = reindex(*partner_itr);
+      partners.modify(_row, same_payer, [&](auto& _partner) {
         _partner.suspended = true;
       });
+      log(event::kind::suspend, _row.id);
     }
   }
 
@@ -472,61 +474,284 @@ namespace x10bit {
       partners.modify(deal_itr, same_payer, [&](auto& _partner) {
         _partner.broker->suspended = false;
       });
+      log(event::kind::resume_deal, deal_itr->id);
     } else {
       check(partner_itr->suspended, "redundant action");
 
-      partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
+      const auto& _row = reindex(*partner_itr);
+      partners.modify(_row, same_payer, [&](auto& _partner) {
         _partner.suspended = false;
       });
+      log(event::kind::resume, _row.id);
     }
   }
 
-  ACTION affiliate::sync(const vector<account>& accounts) {
+  ACTION affiliate::sync(const vector<account>& accounts, const uint32_t& epoch, const uint64_t& seq) {
     utils::require_init(state);
     require_auth(get_self());
 
     auto _state = state.get();
+    acknowledge(_state, epoch, seq);
     const auto partners_account_idx = partners.get_index<"account"_n>();
 
     for (const auto& _account : accounts) {
       utils::safe_require_recipient(_account.owner);
-      const auto partner_itr = partners_account_idx.require_find(
-        _account.owner.value,
-        string("partner (" + utils::to_string(_account.owner) + ") does not exist").c_str()
-      );
-      const auto license_itr = licenses.require_find(
-        _account.license,
-        string("invalid license of " + utils::to_string(_account.owner)).c_str()
-      );
-      check(!partner_itr->suspended, "usage of suspended partner (" + utils::to_string(_account.owner) + ")");
-      check(utils::contains(partner_itr->contracts, _account.license), "license of " + utils::to_string(_account.owner) + " spoofing");
-      check(_account.saldo.is_valid(), "invalid saldo for " + utils::to_string(_account.owner));
-      check(_account.saldo.amount != 0, "redundant action for " + utils::to_string(_account.owner));
-      check(_account.saldo.symbol == EOS_SYMBOL, "invalid saldo symbol for " + utils::to_string(_account.owner));
+      const auto owner = [&] { return utils::to_string(_account.owner); };
+      const auto partner_itr = partners_account_idx.find(_account.owner.value);
+      check(partner_itr != partners_account_idx.end(), [&] { return "partner (" + owner() + ") does not exist"; });
+      const auto license_itr = licenses.find(_account.license);
+      check(license_itr != licenses.end(), [&] { return "invalid license of " + owner(); });
+      check(!partner_itr->suspended, [&] { return "usage of suspended partner (" + owner() + ")"; });
+      check(partner_itr->contracts.contains(_account.license), [&] { return "license of " + owner() + " spoofing"; });
+      check(_account.saldo.is_valid(), [&] { return "invalid saldo for " + owner(); });
+      check(_account.saldo.amount != 0, [&] { return "redundant action for " + owner(); });
+      check(_account.saldo.symbol == EOS_SYMBOL, [&] { return "invalid saldo symbol for " + owner(); });
+
+      credit(*partner_itr, _account.saldo, _state.locked);
+      log(event::kind::credit, partner_itr->id, _account.license, _account.saldo);
+    }
 
-      partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
-        _partner.balance += _account.saldo;
-      });
+    _state.sync = current_time_point();
+    save_state(_state);
+  }
+
+  ACTION affiliate::syncsorted(const vector<sorted_account>& accounts, const uint32_t& epoch, const uint64_t& seq) {
+    utils::require_init(state);
+    require_auth(get_self());
+    check(!accounts.empty(), "redundant action");
 
-      if (_account.saldo.amount > 0) {
-        _state.locked += partner_itr->balance.amount > 0
-                      ? _account.saldo
-                      : max(partner_itr->balance + _account.saldo, asset{0ll, EOS_SYMBOL});
-      } else if (partner_itr->balance.amount > 0) {
-        _state.locked += max(_account.saldo, -partner_itr->balance);
+    auto _state = state.get();
+    acknowledge(_state, epoch, seq);
+    auto partner_itr = partners.lower_bound(accounts.front().partner);
+    vector<uuid> known_licenses;
+
+    for (size_t i = 0; i < accounts.size(); i++) {
+      const auto& _account = accounts[i];
+      const auto id = [&] { return utils::to_string(_account.partner); };
+      check(i == 0 || accounts[i - 1].partner < _account.partner, "accounts must be sorted by partner id");
+
+      // merge-join: the next partner is usually the next row, a gap is jumped over
+      if (partner_itr != partners.end() && partner_itr->id < _account.partner) {
+        partner_itr++;
+        if (partner_itr != partners.end() && partner_itr->id < _account.partner)
+          partner_itr = partners.lower_bound(_account.partner);
       }
+      check(
+        partner_itr != partners.end() && partner_itr->id == _account.partner,
+        [&] { return "partner #" + id() + " does not exist"; }
+      );
+
+      if (!utils::contains(known_licenses, _account.license)) {
+        check(licenses.find(_account.license) != licenses.end(), [&] { return "invalid license of partner #" + id(); });
+        known_licenses.push_back(_account.license);
+      }
+
+      utils::safe_require_recipient(partner_itr->primary);
+      check(!partner_itr->suspended, [&] { return "usage of suspended partner #" + id(); });
+      check(partner_itr->contracts.contains(_account.license), [&] { return "license of partner #" + id() + " spoofing"; });
+      check(_account.saldo.is_valid(), [&] { return "invalid saldo for partner #" + id(); });
+      check(_account.saldo.amount != 0, [&] { return "redundant action for partner #" + id(); });
+      check(_account.saldo.symbol == EOS_SYMBOL, [&] { return "invalid saldo symbol for partner #" + id(); });
+
+      credit(*partner_itr, _account.saldo, _state.locked);
+      log(event::kind::credit, partner_itr->id, _account.license, _account.saldo);
     }
 
     _state.sync = current_time_point();
-    state.set(_state, get_self());
+    save_state(_state);
+  }
+
+  // Sync batches may land out of order as long as they stay within 64 sequence
+  // numbers of the oldest one missing; a new epoch starts once the previous one
+  // has no gaps left
+  void affiliate::acknowledge(datastore::state& _state, const uint32_t epoch, const uint64_t seq) {
+    auto window = _state.window.value_or(sync_window{0, 0, 0});
+
+    if (epoch != window.epoch) {
+      check(epoch > window.epoch, "stale sync epoch");
+      check(window.applied == 0, "previous sync epoch has gaps");
+      window = {epoch, 0, 0};
+    }
+
+    check(seq >= window.base, "sync batch was already applied");
+    check(seq - window.base <= 64, "sync batch is too far ahead");
+
+    if (seq == window.base) {
+      window.base++;
+      // slide over the batches which landed ahead of this one
+      while (window.applied & 1) {
+        window.applied >>= 1;
+        window.base++;
+      }
+      window.applied >>= 1;
+    } else {
+      const uint64_t bit = uint64_t(1) << (seq - window.base - 1);
+      check(!(window.applied & bit), "sync batch was already applied");
+      window.applied |= bit;
+    }
+
+    _state.window.emplace(window);
+  }
+
+  // Partners written before the eol index have no entry in it until migration 0x04
+  // rebuilds them, and multi_index can't move a missing entry, so a partner whose
+  // eol key is about to change is rebuilt first unless it is known to be indexed.
+  // Partners are paid for by the contract, the payer stays the same.
+  const affiliate::partner& affiliate::reindex(const partner& _partner) {
+    if (state.get().version >= SWEEP_VERSION)
+      return _partner;
+
+    if (schema.exists()) {
+      const auto _schema = schema.get();
+      if (_schema.version == SWEEP_VERSION && _partner.id < _schema.cursors.front().next)
+        return _partner;
+    }
+
+    const auto id = _partner.id;
+    migration::rebuild(partners, _partner, get_self());
+    return partners.get(id);
+  }
+
+  // Builds the upline of the partner out of the one of its broker, which is built
+  // first if missing (rows written before the closure table existed). Ids never
+  // change, so delegate, insure and failover leave the closure as is.
+  void affiliate::link(const partner& _partner) {
+    if (!_partner.broker.has_value())
+      return;
+
+    accounting::metered<multi_index_uplines> uplines(get_self(), _partner.id, accountant);
+    if (uplines.begin() != uplines.end())
+      return;
+
+    const auto broker_ptr = get_if<uuid>(&_partner.broker->self);
+    check(broker_ptr != nullptr, "invalid broker reference");
+    link(partners.get(*broker_ptr, "broker does not exist"));
+
+    uplines.emplace(get_self(), [&](auto& _upline) {
+      _upline.depth    = 1;
+      _upline.ancestor = *broker_ptr;
+      _upline.license  = _partner.broker->license;
+      _upline.rate     = _partner.broker->rate;
+    });
+
+    const multi_index_uplines broker_uplines(get_self(), *broker_ptr);
+    for (const auto& _ancestor : broker_uplines) {
+      uplines.emplace(get_self(), [&](auto& _upline) {
+        _upline       = _ancestor;
+        _upline.depth = _ancestor.depth + 1;
+      });
+    }
+  }
+
+  // Descendants keep their own copies, so the upline of a partner who quit is
+  // dropped without touching them
+  void affiliate::unlink(const partner& _partner) {
+    accounting::metered<multi_index_uplines> uplines(get_self(), _partner.id, accountant);
+    for (auto upline_itr = uplines.begin(); upline_itr != uplines.end();)
+      upline_itr = uplines.erase(upline_itr);
+  }
+
+  // Validates a rate against the limit of the license: equal to a fixed rate,
+  // within a range, or left to the brokers of a p2p license
+  void affiliate::check_rate(const descriptor& _license, const optional<rate_t>& rate) {
+    check(!rate.has_value() || rate->is_valid(), "rate must be between 0 and 1 (incl.) in ppm");
+
+    switch (static_cast<descriptor::rate_kind>(_license.kind)) {
+      case descriptor::rate_kind::fixed:
+        check(
+          rate.has_value() && rate.value() == _license.from,
+          [&] { return "rate value must be equal to " + _license.from.to_string(); }
+        );
+        break;
+      case descriptor::rate_kind::range:
+        check(
+          rate.has_value() && _license.accepts(rate.value()),
+          [&] { return "rate value must be in range from " + _license.from.to_string() + " to " + _license.to.to_string() + " (incl.)"; }
+        );
+        break;
+      case descriptor::rate_kind::p2p:
+        check(!rate.has_value(), "rate value must be unspecified");
+        break;
+      default: check(false, "invalid rate type");
+    }
+  }
+
+  // Descriptor of the license, compiled on the fly if it hasn't been stored yet
+  // (see migration 0x06)
+  affiliate::descriptor affiliate::describe(const uuid& license, const char* error_msg) {
+    const auto descriptor_itr = descriptors.find(license);
+    return descriptor_itr != descriptors.end()
+      ? *descriptor_itr
+      : descriptor::compile(licenses.get(license, error_msg));
+  }
+
+  void affiliate::recompile(const license& _license) {
+    const auto descriptor_itr = descriptors.find(_license.id);
+    if (descriptor_itr == descriptors.end()) {
+      descriptors.emplace(get_self(), [&](auto& _descriptor) {
+        _descriptor = descriptor::compile(_license);
+      });
+    } else {
+      descriptors.modify(descriptor_itr, same_payer, [&](auto& _descriptor) {
+        _descriptor = descriptor::compile(_license);
+      });
+    }
+  }
+
+  // Records the holder of the name, whatever it held before
+  void affiliate::enroll(
+    accounting::metered<multi_index_registry>& table,
+    const name&                                 account,
+    const registration::role                    role,
+    const uuid&                                 id,
+    const name&                                 payer
+  ) {
+    const auto registration_itr = table.find(account.value);
+    if (registration_itr == table.end()) {
+      table.emplace(payer, [&](auto& _registration) {
+        _registration.account = account;
+        _registration.role    = static_cast<uint8_t>(role);
+        _registration.id      = id;
+      });
+    } else {
+      table.modify(registration_itr, same_payer, [&](auto& _registration) {
+        _registration.role = static_cast<uint8_t>(role);
+        _registration.id   = id;
+      });
+    }
+  }
+
+  void affiliate::release(accounting::metered<multi_index_registry>& table, const name& account) {
+    if (!account)
+      return;
+
+    const auto registration_itr = table.find(account.value);
+    if (registration_itr != table.end())
+      table.erase(registration_itr);
+  }
+
+  void affiliate::credit(const partner& _partner, const asset& saldo, asset& locked) {
+    const auto balance = _partner.balance;
+
+    partners.modify(_partner, same_payer, [&](auto& _row) {
+      _row.balance += saldo;
+    });
+
+    if (saldo.amount > 0) {
+      locked += balance.amount > 0
+              ? saldo
+              : max(balance + saldo, asset{0ll, EOS_SYMBOL});
+    } else if (balance.amount > 0) {
+      locked += max(saldo, -balance);
+    }
   }
 
   ACTION affiliate::apply(
-    const name&  account,
-    const uuid&  license,
-    const float& rate,
-    const asset& discount,
-          actor& broker
+    const name&   account,
+    const uuid&   license,
+    const rate_t& rate,
+    const asset&  discount,
+          actor&  broker
   ) {
     utils::require_init(state);
     require_auth(account);
@@ -535,29 +760,15 @@ namespace x10bit {
 
     check_partner(account);
 
-    const auto license_itr = licenses.require_find(license, "invalid license");
-    check(license_itr->active, "usage of inactive license");
-    check(!license_itr->archived, "usage of archived license");
+    const auto _license = describe(license, "invalid license");
+    check(_license.is(descriptor::active), "usage of inactive license");
+    check(!_license.is(descriptor::archived), "usage of archived license");
     check(
-      !license_itr->terms.privileged_access && license_itr->terms.global_program,
+      !_license.is(descriptor::privileged_access) && _license.is(descriptor::global_program),
       "missing required authority for such license"
     );
-
-    visit(utils::make_visitor(
-      [&](const license_rate::fixed& fixed_rate) {
-        check(
-          rate == fixed_rate,
-          "rate value must be equal to " + utils::to_string(fixed_rate)
-        );
-      },
-      [&](const license_rate::range& range_rate) {
-        check(
-          rate >= range_rate.from && rate <= range_rate.to,
-          "rate value must be in range from " + utils::to_string(range_rate.from) + " to " + utils::to_string(range_rate.to) + " (incl.)"
-        );
-      },
-      [&](auto&&) { check(false, "invalid rate type"); }
-    ), license_itr->rate.limit);
+    check(!_license.is(descriptor::rate_kind::p2p), "invalid rate type");
+    check_rate(_license, rate);
 
     {
       const auto partners_account_idx = partners.get_index<"account"_n>();
@@ -582,46 +793,45 @@ namespace x10bit {
         broker.root = make_optional(root_itr->id);
       }
 
-      const auto broker_license = licenses.get(
-        broker.license, "invalid broker license"
-      );
-      const auto& broker_scope = broker_license.terms.allowed_scope;
+      const auto broker_license = describe(broker.license, "invalid broker license");
 
       check(!broker_itr->suspended, "usage of suspended broker");
-      check(utils::contains(broker_itr->contracts, broker.license), "broker license spoofing");
-      check(utils::contains(broker_scope, license_itr->id), "broker is out of scope");
-
-      visit(utils::make_visitor(
-        [&](const license_rate::p2p& p2p_rate) {
-          check(
-            broker.rate >= p2p_rate.from && broker.rate <= p2p_rate.to,
-            "broker rate value must be in range from " + utils::to_string(p2p_rate.from) + " to " + utils::to_string(p2p_rate.to) + " (incl.)"
-          );
-        },
-        [&](auto&&) {
-          const auto broker_rate = broker_itr->contracts.at(broker.license).value();
-          check(
-            broker.rate == broker_rate,
-            "broker rate value must be equal to " + utils::to_string(broker_rate)
-          );
-        }
-      ), broker_license.rate.limit);
+      check(broker_itr->contracts.contains(broker.license), "broker license spoofing");
+      check(broker_license.allows(_license.id), "broker is out of scope");
+
+      check(broker.rate.is_valid(), "broker rate must be between 0 and 1 (incl.) in ppm");
+      if (broker_license.is(descriptor::rate_kind::p2p)) {
+        check(
+          broker_license.accepts(broker.rate),
+          [&] { return "broker rate value must be in range from " + broker_license.from.to_string() + " to " + broker_license.to.to_string() + " (incl.)"; }
+        );
+      } else {
+        const auto broker_rate = broker_itr->contracts.at(broker.license).value();
+        check(
+          broker.rate == broker_rate,
+          [&] { return "broker rate value must be equal to " + broker_rate.to_string(); }
+        );
+      }
     }
 
-    utils::check_asset(discount, 0, license_itr->fee.amount);
+    utils::check_asset(discount, 0, _license.fee.amount);
 
-    applications.emplace(account, [&](auto& _application) {
+    const auto application_itr = applications.emplace(account, [&](auto& _application) {
       _application.id        = applications.available_primary_key();
       _application.owner     = account;
       _application.affiliate = ""_n;
-      _application.license   = license_itr->id;
+      _application.license   = _license.id;
       _application.rate      = rate;
-      _application.fee       = license_itr->fee;
+      _application.fee       = _license.fee;
       _application.broker    = make_optional(broker);
       _application.discount  = discount;
       _application.deposit   = asset{0ll, EOS_SYMBOL};
       _application.eol       = current_time_point() + state.get().ttl.application;
     });
+
+    log(event::kind::apply, application_itr->id, _license.id);
+
+    enroll(registry, account, registration::role::applicant, application_itr->id, account);
   }
 
   ACTION affiliate::refuse(const uuid& application) {
@@ -634,29 +844,72 @@ namespace x10bit {
     const auto has_auth_owner = has_auth(application_itr->owner);
     check(
       has_auth_self || has_auth_owner,
-      "missing required authority of " + utils::to_string(get_self()) + " or " + utils::to_string(application_itr->owner)
+      [&] { return "missing required authority of " + utils::to_string(get_self()) + " or " + utils::to_string(application_itr->owner); }
     );
     if (has_auth_self && !has_auth_owner) {
       utils::safe_require_recipient(application_itr->owner);
       check(current_time_point() >= application_itr->eol, "application has not expired");
     }
 
-    applications.erase(application_itr);
-
-    if (application_itr->deposit.amount > 0) {
-      action(
-        permission_level{BANK_ACCOUNT, CODE_PERMISSION},
-        EOSIO_TOKEN,
-        "transfer"_n,
-        make_tuple(
-          BANK_ACCOUNT,
-          application_itr->owner,
-          application_itr->deposit,
-          string("Affiliate license deposit refund (16bit.partners)"),
-          get_self()
-        )
-      ).send();
+    vector<payouts::payment> refunds;
+    reap(*application_itr, refunds);
+    refund(refunds);
+  }
+
+  // Reaps up to `max_rows` expired applications in the order of their eol, the
+  // deposits are refunded in a single payout
+  ACTION affiliate::expire(const uint64_t& max_rows) {
+    utils::require_init(state);
+    require_auth(get_self());
+    check(max_rows > 0, "max_rows must be positive");
+
+    const auto now = current_time_point();
+    const auto applications_eol_idx = applications.get_index<"eol"_n>();
+
+    vector<payouts::payment> refunds;
+    uint64_t rows = 0;
+
+    for (
+      auto application_itr = applications_eol_idx.begin();
+      rows < max_rows && application_itr != applications_eol_idx.end() && application_itr->eol <= now;
+      rows++
+    ) {
+      reap(*application_itr++, refunds);
     }
+    check(rows > 0, "redundant action");
+
+    refund(refunds);
+  }
+
+  // Removes the application, its deposit is queued for the refund
+  void affiliate::reap(const application& _application, vector<payouts::payment>& refunds) {
+    if (_application.deposit.amount > 0)
+      refunds.push_back({_application.owner, _application.deposit});
+
+    release(registry, _application.owner);
+    release(tags, _application.affiliate);
+    log(event::kind::refuse, _application.id, _application.license, -_application.deposit);
+    applications.erase(_application);
+  }
+
+  // Deposits were locked once funded, and payouts to non-partners leave the locked
+  // funds as they are (see affiliate::transfer), so they are released here
+  void affiliate::refund(const vector<payouts::payment>& refunds) {
+    if (refunds.empty())
+      return;
+
+    auto _state = state.get();
+    auto refunded = asset{0ll, EOS_SYMBOL};
+    for (const auto& _refund : refunds)
+      refunded += _refund.quantity;
+
+    _state.locked = max(_state.locked - refunded, asset{0ll, EOS_SYMBOL});
+    save_state(_state);
+
+    payouts::send(
+      BANK_ACCOUNT, {get_self(), get_self_permission()},
+      refunds, payouts::memo::deposit_refund
+    );
   }
 
   NOTIFY affiliate::transfer(
@@ -682,26 +935,46 @@ namespace x10bit {
         "fake token transfer"
       );
 
-            auto _state = state.get();
-      const auto partners_account_idx     = partners.get_index<"account"_n>();
-      const auto applications_account_idx = applications.get_index<"account"_n>();
-      const auto application_itr = applications_account_idx.find(from.value);
-      const auto partner_itr     = partners_account_idx.find(from.value);
+      auto _state = state.get();
 
-      if (application_itr != applications_account_idx.end()) {
-        applications.modify(*application_itr, same_payer, [&](auto& _application) {
+      const auto fund_application = [&](const application& _row) {
+        check(_row.owner == from, "deposit target mismatch");
+        applications.modify(_row, same_payer, [&](auto& _application) {
           _application.deposit += quantity;
         });
-      } else if (partner_itr != partners_account_idx.end()) {
-        partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
+        log(event::kind::deposit, _row.id, _row.license, quantity);
+      };
+      const auto fund_partner = [&](const partner& _row) {
+        check(_row.primary == from, "deposit target mismatch");
+        partners.modify(_row, same_payer, [&](auto& _partner) {
           _partner.balance += quantity;
         });
+        log(event::kind::credit, _row.id, 0, quantity);
+      };
+
+      const auto target = parse_deposit_memo(memo);
+      if (target.has_value()) {
+        if (target->type == deposit_target::application)
+          fund_application(applications.get(target->id, "deposit target does not exist"));
+        else
+          fund_partner(partners.get(target->id, "deposit target does not exist"));
       } else {
-        check(false, "no viable target");
+        // untagged deposits are matched by the account
+        const auto applications_account_idx = applications.get_index<"account"_n>();
+        const auto application_itr = applications_account_idx.find(from.value);
+
+        if (application_itr != applications_account_idx.end()) {
+          fund_application(*application_itr);
+        } else {
+          const auto partners_account_idx = partners.get_index<"account"_n>();
+          const auto partner_itr = partners_account_idx.find(from.value);
+          check(partner_itr != partners_account_idx.end(), "no viable target");
+          fund_partner(*partner_itr);
+        }
       }
 
       _state.locked += quantity;
-      state.set(_state, get_self());
+      save_state(_state);
     } else if (from == get_self()) {
       utils::require_account(to);
     } else if (from == BANK_ACCOUNT) {
@@ -713,10 +986,12 @@ namespace x10bit {
 
       if (partners_account_idx.find(to.value) != partners_account_idx.end()) {
         _state.locked -= quantity;
-        state.set(_state, get_self());
+        save_state(_state);
       } else {
-        const auto balance = token::get_balance(EOSIO_TOKEN, BANK_ACCOUNT, EOS_SYMBOL.code());
-        check(_state.locked <= balance, "overdraft is not allowed");
+        // the bank handles the transfer first, and the locked funds of the contract
+        // are declared to it, so they are already deducted from the free balance
+        const auto treasury = x10bit::datastore::bank::get_treasury(BANK_ACCOUNT);
+        check(treasury.free_balance().amount >= 0, "overdraft is not allowed");
       }
     } else { return; }
   }
@@ -732,50 +1007,57 @@ namespace x10bit {
       partner.value, "application does not exist"
     );
 
-    auto payable_fee = application_itr->fee - application_itr->discount;
-    check(payable_fee <= application_itr->deposit, "deposit is not enough to cover fee");
+    // the row is read after it is erased below
+    const auto application = *application_itr;
+
+    auto payable_fee = application.fee - application.discount;
+    check(payable_fee <= application.deposit, "deposit is not enough to cover fee");
     
     applications.erase(*application_itr);
 
-    partners.emplace(get_self(), [&](auto& _partner) {
+    const auto partner_itr = partners.emplace(get_self(), [&](auto& _partner) {
       _partner.id        = partners.available_primary_key();
-      _partner.primary   = application_itr->owner;
+      _partner.primary   = application.owner;
       _partner.standby   = ""_n;
-      _partner.affiliate = application_itr->affiliate;
-      _partner.contracts = {{application_itr->license, application_itr->rate}};
-      _partner.broker    = application_itr->broker;
-      _partner.balance   = application_itr->deposit - payable_fee;
+      _partner.affiliate = application.affiliate;
+      _partner.contracts = {{application.license, application.rate}};
+      _partner.broker    = application.broker;
+      _partner.balance   = application.deposit - payable_fee;
       _partner.suspended = false;
       _partner.eol       = current_time_point() + state.get().ttl.safeguard;
     });
+    link(*partner_itr);
+    log(event::kind::join, partner_itr->id, partner_itr->contracts.begin()->first, partner_itr->balance);
+
+    enroll(registry, partner_itr->primary, registration::role::primary, partner_itr->id, get_self());
+    if (partner_itr->affiliate)
+      enroll(tags, partner_itr->affiliate, registration::role::affiliate, partner_itr->id, get_self());
 
-    if (application_itr->broker.has_value() && !application_itr->broker->suspended) {
-      const auto broker_ptr = get_if<uuid>(&application_itr->broker->self);
+    if (application.broker.has_value() && !application.broker->suspended) {
+      const auto broker_ptr = get_if<uuid>(&application.broker->self);
       check(broker_ptr != nullptr, "invalid broker reference");
       const auto broker_itr = partners.require_find(
         *broker_ptr, "broker does not exist"
       );
-      const auto license_itr = licenses.require_find(
-        application_itr->broker->license, "invalid broker license"
-      );
+      const auto broker_license = describe(application.broker->license, "invalid broker license");
 
       if (
-        utils::contains(broker_itr->contracts, application_itr->broker->license) &&
-        !broker_itr->suspended && license_itr->terms.instant_payout
+        broker_itr->contracts.contains(application.broker->license) &&
+        !broker_itr->suspended && broker_license.is(descriptor::instant_payout)
       ) {
-        const auto broker_reward =
-          asset(payable_fee.amount * application_itr->broker->rate, EOS_SYMBOL);
+        const auto broker_reward = application.broker->rate.apply(payable_fee);
         
         payable_fee -= broker_reward;
 
         partners.modify(broker_itr, same_payer, [&](auto& _partner) {
           _partner.balance += broker_reward;
         });
+        log(event::kind::credit, broker_itr->id, application.broker->license, broker_reward);
       }
     }
 
     _state.locked = max(_state.locked - payable_fee, asset{0ll, EOS_SYMBOL});
-    state.set(_state, get_self());
+    save_state(_state);
   }
 
   ACTION affiliate::prolong(const name& partner) {
@@ -788,7 +1070,7 @@ namespace x10bit {
       partner.value, "partner does not exist"
     );
 
-    partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
+    partners.modify(reindex(*partner_itr), same_payer, [&](auto& _partner) {
       _partner.eol = current_time_point() + state.get().ttl.safeguard;
     });
   }
@@ -809,26 +1091,19 @@ namespace x10bit {
     partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
       _partner.balance -= quantity;
     });
+    log(event::kind::withdraw, partner_itr->id, 0, -quantity);
 
-    action(
-      permission_level{BANK_ACCOUNT, CODE_PERMISSION},
-      EOSIO_TOKEN,
-      "transfer"_n,
-      make_tuple(
-        BANK_ACCOUNT,
-        payee,
-        quantity,
-        string("Affiliate program profit from 16bit.partners"),
-        get_self()
-      )
-    ).send();
+    payouts::send(
+      BANK_ACCOUNT, {get_self(), get_self_permission()},
+      {{payee, quantity}}, payouts::memo::affiliate_profit
+    );
   }
 
   ACTION affiliate::update(
-    const name&            partner,
-    const uuid&            license,
-    const optional<float>& rate,
-    const optional<asset>& balance
+    const name&             partner,
+    const uuid&             license,
+    const optional<rate_t>& rate,
+    const optional<asset>&  balance
   ) {
     utils::require_init(state);
     require_auth(partner);
@@ -839,54 +1114,43 @@ namespace x10bit {
     const auto partner_itr = partners_account_idx.require_find(
       partner.value, "partner does not exist"
     );
-    const auto license_itr = licenses.require_find(license, "invalid license");
+    const auto _license = describe(license, "invalid license");
 
     check(!partner_itr->suspended, "usage of suspended partner");
-    check(utils::contains(partner_itr->contracts, license), "license spoofing");
+    check(partner_itr->contracts.contains(license), "license spoofing");
     check(rate.has_value() || balance.has_value(), "redundant action");
 
     if (rate.has_value()) {
       check(partner_itr->contracts.at(license) != rate.value(), "redundant action");
-      visit(utils::make_visitor(
-        [&](const license_rate::range& range_rate) {
-          check(
-            rate >= range_rate.from && rate <= range_rate.to,
-            "rate value must be in range from " + utils::to_string(range_rate.from) + " to " + utils::to_string(range_rate.to) + " (incl.)"
-          );
-        },
-        [&](auto&&) {
-          check(false, "license terms not met (rate is not updatable due to limit type)");
-        }
-      ), license_itr->rate.limit);
+      check(
+        _license.is(descriptor::rate_kind::range),
+        "license terms not met (rate is not updatable due to limit type)"
+      );
+      check_rate(_license, rate);
     }
 
     if (balance.has_value())
       check(balance.value().amount != 0, "redundant action");
 
-    partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
-      if (rate.has_value())
+    if (rate.has_value()) {
+      partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
         _partner.contracts.at(license) = rate;
-      if (balance.has_value())
-        _partner.balance += balance.value();
-    });
+      });
+      log(event::kind::rate, partner_itr->id, license);
+    }
 
     if (balance.has_value()) {
       auto _state = state.get();
-      if (balance.value().amount > 0) {
-        _state.locked += partner_itr->balance.amount > 0
-                      ? balance.value()
-                      : max(partner_itr->balance + balance.value(), asset{0ll, EOS_SYMBOL});
-      } else if (partner_itr->balance.amount > 0) {
-        _state.locked += max(balance.value(), -partner_itr->balance);
-      }
-      state.set(_state, get_self());
+      credit(*partner_itr, balance.value(), _state.locked);
+      log(event::kind::credit, partner_itr->id, license, balance.value());
+      save_state(_state);
     }
   }
 
   ACTION affiliate::upgrade(
     const name&             partner,
     const pair<uuid, uuid>& license,
-    const optional<float>&  rate
+    const optional<rate_t>& rate
   ) {
     utils::require_init(state);
     require_auth(partner);
@@ -898,65 +1162,46 @@ namespace x10bit {
     const auto partner_itr = partners_account_idx.require_find(
       partner.value, "partner does not exist"
     );
-    const auto current_license_itr = licenses.require_find(
-      current_license_id, "invalid current license"
-    );
-    const auto target_license_itr = licenses.require_find(
-      target_license_id, "invalid target license"
-    );
-    const auto upgrade_fee = target_license_itr->fee - current_license_itr->fee;
+    const auto current_license = describe(current_license_id, "invalid current license");
+    const auto target_license  = describe(target_license_id, "invalid target license");
+    const auto upgrade_fee = target_license.fee - current_license.fee;
 
     check(!partner_itr->suspended, "usage of suspended partner");
     check(
-      utils::contains(partner_itr->contracts, current_license_id),
+      partner_itr->contracts.contains(current_license_id),
       "current license spoofing"
     );
-    check(!utils::contains(partner_itr->contracts, target_license_id), "redundant action");
-    check(current_license_itr->terms.upgradable, "current license is non-upgradable");
-    check(target_license_itr->active, "target license is inactive");
-    check(!target_license_itr->archived, "target license is archived");
+    check(!partner_itr->contracts.contains(target_license_id), "redundant action");
+    check(current_license.is(descriptor::upgradable), "current license is non-upgradable");
+    check(target_license.is(descriptor::active), "target license is inactive");
+    check(!target_license.is(descriptor::archived), "target license is archived");
     check(
-      !target_license_itr->terms.privileged_access && target_license_itr->terms.global_program,
+      !target_license.is(descriptor::privileged_access) && target_license.is(descriptor::global_program),
       "missing required authority for such target license"
     );
     check(
-      current_license_itr->terms.franchise == target_license_itr->terms.franchise,
+      current_license.is(descriptor::franchise) == target_license.is(descriptor::franchise),
       "franchise terms not met"
     );
-
-    visit(utils::make_visitor(
-      [&](const license_rate::fixed&, const license_rate::fixed& fixed_rate) {
-        check(
-          rate == fixed_rate,
-          "rate value must be equal to " + utils::to_string(fixed_rate)
-        );
-      },
-      [&](const license_rate::range&, const license_rate::range& range_rate) {
-        check(
-          rate >= range_rate.from && rate <= range_rate.to,
-          "rate value must be in range from " + utils::to_string(range_rate.from) + " to " + utils::to_string(range_rate.to) + " (incl.)"
-        );
-      },
-      [&](const license_rate::p2p&, const license_rate::p2p&) {
-        check(!rate.has_value(), "rate value must be unspecified");
-      },
-      [&](auto&&, auto&&) {
-        check(false, "upgrade terms not met (rate limit types are not consistent)");
-      }
-    ), current_license_itr->rate.limit, target_license_itr->rate.limit);
+    check(
+      current_license.kind == target_license.kind,
+      "upgrade terms not met (rate limit types are not consistent)"
+    );
+    check_rate(target_license, rate);
 
     check(upgrade_fee.amount >= 0, "license downgrade is not allowed");
     check(upgrade_fee <= partner_itr->balance, "balance is not enough to cover upgrade fee");
 
     partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
-      _partner.contracts.erase(current_license_itr->id);
-      _partner.contracts.insert(make_pair(target_license_itr->id, rate));
+      _partner.contracts.erase(current_license_id);
+      _partner.contracts.insert(make_pair(target_license_id, rate));
       _partner.balance -= upgrade_fee;
     });
+    log(event::kind::upgrade, partner_itr->id, target_license_id, -upgrade_fee);
 
     auto _state = state.get();
     _state.locked = max(_state.locked - upgrade_fee, asset{0ll, EOS_SYMBOL});
-    state.set(_state, get_self());
+    save_state(_state);
   }
 
   ACTION affiliate::insure(const name& partner, const name& standby) {
@@ -974,9 +1219,13 @@ namespace x10bit {
 
     check_partner(standby);
 
+    release(registry, partner_itr->standby);
+    enroll(registry, standby, registration::role::standby, partner_itr->id, get_self());
+
     partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
       _partner.standby = standby;
     });
+    log(event::kind::accounts, partner_itr->id);
   }
 
   ACTION affiliate::failover(const name& partner) {
@@ -993,10 +1242,17 @@ namespace x10bit {
     require_auth(partner_itr->standby);
     utils::require_account(partner_itr->standby);
 
+    const auto primary = partner_itr->primary;
+    const auto standby = partner_itr->standby;
+
+    enroll(registry, standby, registration::role::primary, partner_itr->id, get_self());
+    enroll(registry, primary, registration::role::standby, partner_itr->id, get_self());
+
     partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
-      _partner.primary = partner_itr->standby;
-      _partner.standby = partner_itr->primary;
+      _partner.primary = standby;
+      _partner.standby = primary;
     });
+    log(event::kind::accounts, partner_itr->id);
   }
 
   ACTION affiliate::delegate(const name& partner, const name& successor) {
@@ -1015,17 +1271,25 @@ namespace x10bit {
     const auto has_auth_partner = has_auth(partner_itr->primary);
     check(
       has_auth_self || has_auth_partner,
-      "missing required authority of " + utils::to_string(get_self()) + " or " + utils::to_string(partner_itr->primary)
+      [&] { return "missing required authority of " + utils::to_string(get_self()) + " or " + utils::to_string(partner_itr->primary); }
     );
     if (has_auth_self && !has_auth_partner)
       check(current_time_point() >= partner_itr->eol, "partner account has not expired");
 
     check_partner(successor);
     
-    partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
+    release(registry, partner_itr->primary);
+    release(registry, partner_itr->standby);
+    enroll(registry, successor, registration::role::primary, partner_itr->id, get_self());
+
+    // the successor starts a safeguard period of its own, as after a sweep handover
+    const auto& _row = reindex(*partner_itr);
+    partners.modify(_row, same_payer, [&](auto& _partner) {
       _partner.primary = successor;
       _partner.standby = ""_n;
+      _partner.eol     = current_time_point() + state.get().ttl.safeguard;
     });
+    log(event::kind::accounts, _row.id);
   }
 
   ACTION affiliate::quit(const name& partner) {
@@ -1039,28 +1303,97 @@ namespace x10bit {
     );
     check(!partner_itr->suspended, "usage of suspended partner");
 
-    partners.modify(*partner_itr, same_payer, [&](auto& _partner) {
+    const auto balance = partner_itr->balance;
+    const auto& _row = reindex(*partner_itr);
+    partners.modify(_row, same_payer, [&](auto& _partner) {
       _partner.contracts.clear();
       _partner.balance   = asset{0ll, EOS_SYMBOL};
       _partner.suspended = true;
     });
+    unlink(_row);
+    log(event::kind::quit, _row.id, 0, -balance);
 
-    if (partner_itr->balance.amount > 0) {
-      action(
-        permission_level{BANK_ACCOUNT, CODE_PERMISSION},
-        EOSIO_TOKEN,
-        "transfer"_n,
-        make_tuple(
-          BANK_ACCOUNT,
-          partner_itr->primary,
-          partner_itr->balance,
-          string("Affiliate program participation termination (16bit.partners)"),
-          get_self()
-        )
-      ).send();
+    if (balance.amount > 0) {
+      payouts::send(
+        BANK_ACCOUNT, {get_self(), get_self_permission()},
+        {{_row.primary, balance}}, payouts::memo::affiliate_termination
+      );
     }
   };
 
+  // Enforces the safeguard TTL on up to `max_rows` partners in the order of their
+  // eol: the standby account takes over for a new safeguard period if there is
+  // one, otherwise the partner is suspended. Either way the partner leaves the
+  // expired range of the index, which thus serves as the cursor between batches.
+  // A suspended partner is recovered by `resume` followed by `delegate` in the same
+  // transaction, since `delegate` refuses suspended partners and the next sweep
+  // would suspend the resumed one again.
+  ACTION affiliate::sweep(const uint64_t& max_rows) {
+    utils::require_init(state);
+    require_auth(get_self());
+    check(max_rows > 0, "max_rows must be positive");
+
+    const auto now = current_time_point();
+    const auto safeguard = state.get().ttl.safeguard;
+    const auto partners_eol_idx = partners.get_index<"eol"_n>();
+    const auto expired = static_cast<uint64_t>(now.time_since_epoch().count());
+
+    uint64_t rows = 0;
+    for (
+      auto partner_itr = partners_eol_idx.begin();
+      rows < max_rows && partner_itr != partners_eol_idx.end() && partner_itr->eol_key() <= expired;
+      rows++
+    ) {
+      const auto& _row = *partner_itr++;
+      utils::safe_require_recipient(_row.primary);
+
+      if (_row.standby) {
+        release(registry, _row.primary);
+        enroll(registry, _row.standby, registration::role::primary, _row.id, get_self());
+      }
+      log(_row.standby ? event::kind::accounts : event::kind::suspend, _row.id);
+
+      partners.modify(_row, same_payer, [&](auto& _partner) {
+        if (_partner.standby) {
+          _partner.primary = _partner.standby;
+          _partner.standby = ""_n;
+          _partner.eol     = now + safeguard;
+        } else {
+          _partner.suspended = true;
+        }
+      });
+    }
+    check(rows > 0, "redundant action");
+  }
+
+  // Journal of the changes made by an action for off-chain indexers, numbered by
+  // `seq` without gaps
+  ACTION affiliate::logevents(const uint64_t& seq, const vector<event>& events) {
+    require_auth(get_self());
+  }
+
+  // Called once the action is over, so that a single logevents carries every change
+  // of the action
+  void affiliate::flush_journal() {
+    if (events.empty() || !state.exists())
+      return;
+
+    const auto seq = journal.get_or_default({0}).seq;
+    journal.set({seq + 1}, get_self());
+
+    action(
+      permission_level{get_self(), get_self_permission()},
+      get_self(),
+      "logevents"_n,
+      make_tuple(seq, events)
+    ).send();
+    events.clear();
+  }
+
+  affiliate::usage affiliate::getusage() {
+    return accountant.get();
+  }
+
   #ifndef DEBUG
     ACTION affiliate::migrate(const uuid& version) {
       require_auth(get_self());
@@ -1068,15 +1401,197 @@ namespace x10bit {
       auto _state = state.get();
       check(_state.version != version, "redundant action");
       check(_state.version < version, "version downgrade is not supported (use \"rollbacks through subsequent updates\" paradigm)");
+      check(_state.version + 1 == version, "versions must be migrated one by one");
+      check(!schema.exists(), "migration is already in progress");
 
+      vector<name> tables;
       switch(version) {
         case 0x00:
           break;
+        case 0x01: // float rates are rewritten as rate_t
+          tables = {"licenses"_n, "applications"_n, "partners"_n};
+          break;
+        case 0x02: // broker tree closure is built for existing partners
+          tables = {"partners"_n};
+          break;
+        case 0x03: // applications get the eol index
+          tables = {"applications"_n};
+          break;
+        case 0x04: // partners get the eol index (see SWEEP_VERSION)
+          tables = {"partners"_n};
+          break;
+        case 0x05: // account names are registered (see REGISTRY_VERSION)
+          tables = {"applications"_n, "partners"_n};
+          break;
+        case 0x06: // licenses are compiled into descriptors
+          tables = {"licenses"_n};
+          break;
+        case 0x07: // usage of the metered tables is tallied from scratch
+          tables = {"licenses"_n, "descriptors"_n, "applications"_n, "partners"_n, "registry"_n, "tags"_n};
+          for (const auto& _table : {"licenses"_n, "descriptors"_n, "applications"_n, "partners"_n, "registry"_n})
+            accountant.reset(_table);
+          break;
         default: check(false, "invalid version");
       }
 
-      _state.version = version;
-      state.set(_state, get_self());
+      if (tables.empty()) {
+        _state.version = version;
+        save_state(_state);
+      } else {
+        schema.set({version, migration::plan(tables)}, get_self());
+      }
+    }
+
+    ACTION affiliate::migratestep(const uint64_t& limit) {
+      require_auth(get_self());
+      check(schema.exists(), "no migration in progress");
+      check(limit > 0, "limit must be positive");
+
+      auto _schema = schema.get();
+      uint64_t budget = limit;
+      for (auto& _cursor : _schema.cursors) {
+        if (!_cursor.done)
+          migrate_rows(_schema.version, _cursor, budget);
+        if (budget == 0)
+          break;
+      }
+
+      const bool done = all_of(
+        _schema.cursors.begin(), _schema.cursors.end(),
+        [](const migration::cursor& _cursor) { return _cursor.done; }
+      );
+
+      if (done) {
+        auto _state = state.get();
+        _state.version = _schema.version;
+        save_state(_state);
+        schema.remove();
+      } else {
+        schema.set(_schema, get_self());
+      }
+    }
+
+    void affiliate::migrate_rows(const uuid& version, migration::cursor& cursor, uint64_t& budget) {
+      const auto normalize_actor = [](optional<actor>& _actor) {
+        if (_actor.has_value())
+          _actor->rate = _actor->rate.normalized();
+      };
+
+      switch(version) {
+        case 0x01:
+          if (cursor.table == "licenses"_n) {
+            migration::advance(licenses, cursor, budget, [&](const auto& _row) {
+              licenses.modify(_row, same_payer, [&](auto& _license) {
+                visit(utils::make_visitor(
+                  [&](license_rate::fixed& fixed_rate) { fixed_rate = fixed_rate.normalized(); },
+                  [&](license_rate::range& range_rate) {
+                    range_rate.from = range_rate.from.normalized();
+                    range_rate.to   = range_rate.to.normalized();
+                  }
+                ), _license.rate.limit);
+              });
+            });
+          } else if (cursor.table == "applications"_n) {
+            migration::advance(applications, cursor, budget, [&](const auto& _row) {
+              applications.modify(_row, same_payer, [&](auto& _application) {
+                if (_application.rate.has_value())
+                  _application.rate = _application.rate->normalized();
+                normalize_actor(_application.broker);
+              });
+            });
+          } else if (cursor.table == "partners"_n) {
+            migration::advance(partners, cursor, budget, [&](const auto& _row) {
+              partners.modify(_row, same_payer, [&](auto& _partner) {
+                for (auto& [_license, _rate] : _partner.contracts)
+                  if (_rate.has_value())
+                    _rate = _rate->normalized();
+                normalize_actor(_partner.broker);
+              });
+            });
+          } else {
+            check(false, "unknown table " + utils::to_string(cursor.table));
+          }
+          break;
+        case 0x02:
+          if (cursor.table == "partners"_n) {
+            migration::advance(partners, cursor, budget, [&](const auto& _row) {
+              if (!_row.suspended)
+                link(_row);
+            });
+          } else {
+            check(false, "unknown table " + utils::to_string(cursor.table));
+          }
+          break;
+        case 0x03:
+          if (cursor.table == "applications"_n) {
+            // applicants paid for their rows, but billing RAM to them takes their
+            // authority, so the contract takes the rebuilt rows over
+            migration::advance(applications, cursor, budget, [&](const auto& _row) {
+              migration::rebuild(applications, _row, get_self());
+            });
+          } else {
+            check(false, "unknown table " + utils::to_string(cursor.table));
+          }
+          break;
+        case 0x04:
+          if (cursor.table == "partners"_n) {
+            migration::advance(partners, cursor, budget, [&](const auto& _row) {
+              migration::rebuild(partners, _row, get_self());
+            });
+          } else {
+            check(false, "unknown table " + utils::to_string(cursor.table));
+          }
+          break;
+        case 0x05:
+          if (cursor.table == "applications"_n) {
+            migration::advance(applications, cursor, budget, [&](const auto& _row) {
+              enroll(registry, _row.owner, registration::role::applicant, _row.id, get_self());
+              if (_row.affiliate)
+                enroll(tags, _row.affiliate, registration::role::affiliate, _row.id, get_self());
+            });
+          } else if (cursor.table == "partners"_n) {
+            migration::advance(partners, cursor, budget, [&](const auto& _row) {
+              enroll(registry, _row.primary, registration::role::primary, _row.id, get_self());
+              if (_row.standby)
+                enroll(registry, _row.standby, registration::role::standby, _row.id, get_self());
+              if (_row.affiliate)
+                enroll(tags, _row.affiliate, registration::role::affiliate, _row.id, get_self());
+            });
+          } else {
+            check(false, "unknown table " + utils::to_string(cursor.table));
+          }
+          break;
+        case 0x06:
+          if (cursor.table == "licenses"_n) {
+            migration::advance(licenses, cursor, budget, [&](const auto& _row) {
+              recompile(_row);
+            });
+          } else {
+            check(false, "unknown table " + utils::to_string(cursor.table));
+          }
+          break;
+        case 0x07:
+          // rows written by other actions in between are metered already, so the
+          // tally is exact only if the contract is idle until the migration is over
+          if (cursor.table == "licenses"_n) {
+            migration::advance(licenses, cursor, budget, [&](const auto& _row) { licenses.tally(_row); });
+          } else if (cursor.table == "descriptors"_n) {
+            migration::advance(descriptors, cursor, budget, [&](const auto& _row) { descriptors.tally(_row); });
+          } else if (cursor.table == "applications"_n) {
+            migration::advance(applications, cursor, budget, [&](const auto& _row) { applications.tally(_row); });
+          } else if (cursor.table == "partners"_n) {
+            migration::advance(partners, cursor, budget, [&](const auto& _row) { partners.tally(_row); });
+          } else if (cursor.table == "registry"_n) {
+            migration::advance(registry, cursor, budget, [&](const auto& _row) { registry.tally(_row); });
+          } else if (cursor.table == "tags"_n) {
+            // same table in another scope, it is accounted under "registry"
+            migration::advance(tags, cursor, budget, [&](const auto& _row) { tags.tally(_row); });
+          } else {
+            check(false, "unknown table " + utils::to_string(cursor.table));
+          }
+          break;
+        default: check(false, "no row migrations for version " + utils::to_string(version) + " (" + utils::to_string(cursor.table) + ")");
+      }
     }
   #else
     ACTION affiliate::reset(const uint8_t& type, const uint64_t& limit) {
@@ -1087,6 +1602,9 @@ namespace x10bit {
         case 1: utils::clear_table(licenses, limit);
         case 2: utils::clear_table(partners, limit);
         case 3: utils::clear_table(applications, limit);
+        case 4: utils::clear_table(registry, limit);
+        case 5: utils::clear_table(tags, limit);
+        case 6: utils::clear_table(descriptors, limit);
           break;
         default: check(false, "unknown type");
       };
@@ -21,36 +21,137 @@
 
 #pragma once
 
+#include <array>
+#include <string_view>
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/transaction.hpp>
+#include "bank/datastore.hpp"
+#include "x10bit/check.hpp"
+#include "x10bit/shards.hpp"
 
 #define NOTIFY            [[eosio::on_notify("*::transfer")]] void
 #define EOS_SYMBOL        symbol("EOS", 4)
 #define EOSIO_TOKEN       name("eosio.token")
-#define GAME_ACCOUNT      name("fairbet.game")
 #define AGENT_ACCOUNT     name("fairbetagent")
 #define VAULT_ACCOUNT     name("fairbetvault")
 #define TRUSTEE_ACCOUNT   name("johnnesmelov")
 #define CODE_PERMISSION   name("code")
 #define PARTNER_FEE_MEMO  "Partner license fee"
 #define GAME_BET_MEMO_SZ  64
+#define GAME_BATCH_MEMO   '#'
 
 using namespace std;
 using namespace eosio;
 
 namespace x10bit {
-  CONTRACT bank : public contract {
+  enum class memo_type : uint8_t { none, bet, partner_fee, text, batch };
+
+  struct memo_header {
+    memo_type type;
+    uint8_t   shard;
+  };
+
+  // Classifies a transfer memo in a single pass over it
+  constexpr memo_header parse_memo(const string_view memo) {
+    if (memo.empty())
+      return {memo_type::none, 0};
+
+    if (memo.size() == GAME_BET_MEMO_SZ) {
+      uint8_t lead = 0;
+      for (size_t i = 0; i < memo.size(); i++) {
+        const char c = memo[i];
+        uint8_t nibble = 0;
+        if (c >= '0' && c <= '9')      nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else return {memo_type::text, 0};
+        if (i < 2) lead = lead << 4 | nibble;
+      }
+      return {memo_type::bet, shards::of(lead)};
+    }
+
+    // a batch of bets of a single shard, "#<shard>:<bet id>,<bet id>,..."
+    if (memo[0] == GAME_BATCH_MEMO) {
+      size_t shard = 0, i = 1;
+      for (; i < memo.size() && memo[i] >= '0' && memo[i] <= '9' && shard < shards::count; i++)
+        shard = shard * 10 + (memo[i] - '0');
+      if (i > 1 && i < memo.size() && memo[i] == ':' && shard < shards::count)
+        return {memo_type::batch, static_cast<uint8_t>(shard)};
+      return {memo_type::text, 0};
+    }
+
+    // the fee may name the application or the partner it is for, e.g. "...:a:<id>"
+    return memo == PARTNER_FEE_MEMO || memo.substr(0, sizeof(PARTNER_FEE_MEMO)) == PARTNER_FEE_MEMO ":"
+      ? memo_header{memo_type::partner_fee, 0}
+      : memo_header{memo_type::text, 0};
+  }
+
+  // Packed size of eosio.token::transfer data, anything beyond it is an extension
+  constexpr size_t transfer_data_size(const size_t memo_size) {
+    size_t varuint_size = 1;
+    for (auto size = memo_size >> 7; size > 0; size >>= 7)
+      varuint_size++;
+    return sizeof(name) * 2 + sizeof(asset) + varuint_size + memo_size;
+  }
+
+  // Contract to be notified of an incoming transfer, indexed by memo type
+  using memo_router = name (*)(const memo_header&);
+  constexpr memo_router memo_routes[] = {
+    [](const memo_header&)        { return name(); },
+    [](const memo_header& header) { return shards::accounts[header.shard]; },
+    [](const memo_header&)        { return AGENT_ACCOUNT; },
+    [](const memo_header&)        { return name(); },
+    [](const memo_header& header) { return shards::accounts[header.shard]; },
+  };
+
+  template<size_t N>
+  constexpr array<name, N + shards::count> make_whitelist(const array<name, N>& senders) {
+    array<name, N + shards::count> whitelist{};
+    for (size_t i = 0; i < N; i++)
+      whitelist[i] = senders[i];
+    for (size_t i = 0; i < shards::count; i++)
+      whitelist[N + i] = shards::accounts[i];
+
+    for (size_t i = 1; i < whitelist.size(); i++)
+      for (size_t j = i; j > 0 && whitelist[j] < whitelist[j - 1]; j--) {
+        const auto swap = whitelist[j];
+        whitelist[j] = whitelist[j - 1];
+        whitelist[j - 1] = swap;
+      }
+    return whitelist;
+  }
+
+  // Sorted at compile time to be looked up with binary search
+  constexpr auto whitelisted_senders = make_whitelist(array<name, 14>{
+    "jetpack.x"_n,
+    "fairbet.bank"_n,
+    "fairbetagent"_n,
+    "fairbetvault"_n,
+    "fairbetbonus"_n,
+    "fairbetproof"_n,
+    "greymassnoop"_n,
+    "tippedtipped"_n,
+    "eosio.token"_n,
+    "eosio.stake"_n,
+    "eosio.names"_n,
+    "eosio.ram"_n,
+    "eosio.rex"_n,
+    "eosio"_n,
+  });
+
+  CONTRACT bank : public datastore::bank {
     public:
-      using contract::contract;
+      using datastore = datastore::bank;
+      using datastore::datastore;
 
       bank(const name& receiver, const name& code, const datastream<const char *>& ds) :
-        contract(receiver, code, ds)
+        datastore(receiver, code, ds)
       {}
 
       struct report {
         asset  expenses;
-        float  reinvestment_rate;
+        rate_t reinvestment_rate;
       };
 
       struct extended_transfer {
@@ -61,6 +162,17 @@ namespace x10bit {
         name   target;
       };
 
+      ACTION init(const rate_t& reinvestment_rate);
+      ACTION reconcile();
+      ACTION declare(const name& source, const asset& locked);
+      ACTION reserve(const name& source, const uint64_t& game, const asset& exposure);
+      ACTION release(const name& source, const uint64_t& game);
+      ACTION payout(
+        const name&                     source,
+        const vector<payouts::payment>& payments,
+        const uint8_t&                  memo,
+        const string&                   arg
+      );
       ACTION withdraw(const asset& profit, const report& current, const report& next);
 
       NOTIFY transfer(
@@ -69,34 +181,5 @@ namespace x10bit {
         const asset&  quantity,
         const string& memo
       );
-
-      /*TABLE state {
-        uuid                 version;
-        asset                locked;
-        asset                expenses;
-        float                reinvestment;
-        time_point           sync;
-
-        EOSLIB_SERIALIZE(state, (version)(locked)(expenses)(reinvestment)(sync));
-      };*/
-
-    private:
-      const vector<name> whitelisted_senders = {
-        "jetpack.x"_n,
-        "fairbet.game"_n,
-        "fairbet.bank"_n,
-        "fairbetagent"_n,
-        "fairbetvault"_n,
-        "fairbetbonus"_n,
-        "fairbetproof"_n,
-        "greymassnoop"_n,
-        "tippedtipped"_n,
-        "eosio.token"_n,
-        "eosio.stake"_n,
-        "eosio.names"_n,
-        "eosio.ram"_n,
-        "eosio.rex"_n,
-        "eosio"_n,
-      };
   };
 }
@@ -0,0 +1,38 @@
+/**
+ * SPDX-License-Identifier: HashCode-EULA-1.1-or-later
+ *
+ * Description / Summary:   Lazy Checks (the "Software")
+ *                          Part of the 16Bit Platform ecosystem
+ *
+ * Authors & Contributors:  Designed and assembled by GeekHack
+ *                          In collaboration with 16Bit team
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * Copyright (c) 2020 GeekHack ÐΞV
+ * Copyright (c) 2021 HashCode Ltd.
+ */
+
+
+#pragma once
+
+#include <type_traits>
+#include <eosio/eosio.hpp>
+
+namespace x10bit {
+  using eosio::check;
+
+  // Takes the failure message as a callable, so that it is formatted only when the
+  // condition fails, e.g. `check(found, [&] { return "no " + owner.to_string(); })`
+  template<typename Lambda, typename = std::enable_if_t<std::is_invocable_v<Lambda>>>
+  inline void check(const bool pred, Lambda&& message) {
+    if (!pred)
+      eosio::check(false, message());
+  }
+}
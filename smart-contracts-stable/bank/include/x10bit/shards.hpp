@@ -0,0 +1,72 @@
+/**
+ * SPDX-License-Identifier: HashCode-EULA-1.1-or-later
+ *
+ * Description / Summary:   Game Shards Registry (the "Software")
+ *                          Part of the 16Bit Platform ecosystem
+ *
+ * Authors & Contributors:  Designed and assembled by GeekHack
+ *                          In collaboration with 16Bit team
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * Copyright (c) 2020 GeekHack ÐΞV
+ * Copyright (c) 2021 HashCode Ltd.
+ */
+
+#pragma once
+
+#include <string_view>
+#include <eosio/eosio.hpp>
+#include <eosio/crypto.hpp>
+
+// Game accounts sharing the bank, in routing order. The bank and every shard
+// must be built with the same list, while each shard gets its own index, e.g.
+//   eosio-cpp -DGAME_SHARD_ACCOUNTS='"fairbet.game"_n,"fairbetgame1"_n' -DGAME_SHARD=1 ...
+#ifndef GAME_SHARD_ACCOUNTS
+  #define GAME_SHARD_ACCOUNTS "fairbet.game"_n
+#endif
+
+using namespace std;
+using namespace eosio;
+
+namespace x10bit {
+  namespace shards {
+    constexpr name   accounts[] = { GAME_SHARD_ACCOUNTS };
+    constexpr size_t count      = sizeof(accounts) / sizeof(accounts[0]);
+
+    static_assert(count > 0 && count <= 0xFF, "invalid number of game shards");
+
+    // Shard of a bet is chosen by the leading byte of its seed, which is the first
+    // hex pair of the memo funding it
+    constexpr uint8_t of(const uint8_t lead) {
+      return lead % count;
+    }
+
+    inline uint8_t of(const checksum256& seed) {
+      return of(*reinterpret_cast<const uint8_t *>(seed.data()));
+    }
+
+    constexpr uint8_t of(const string_view hex) {
+      const auto nibble = [](const char c) -> uint8_t {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return 0;
+      };
+      return hex.size() < 2 ? 0 : of(uint8_t(nibble(hex[0]) << 4 | nibble(hex[1])));
+    }
+
+    constexpr bool contains(const name& account) {
+      for (const auto& _account : accounts)
+        if (_account == account)
+          return true;
+      return false;
+    }
+  }
+}
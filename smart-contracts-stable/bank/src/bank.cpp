@@ -21,23 +21,169 @@
 #include <eosio.token/eosio.token.hpp>
 
 namespace x10bit {
-  /*ACTION bank::init(
-    const asset& locked,
-    const asset& expenses,
-    const float& reinvestment,
-  ) {
+  ACTION bank::init(const rate_t& reinvestment_rate) {
     require_auth(get_self());
-    
-    check(!state_.exists(), "already initialized");
-    utils::check_asset(locked);
-    utils::check_asset(expenses);
-    check(
-      reinvestment >= 0 && reinvestment < 1,
-      "reinvestment rate must be equal to or greater than zero and less than one"
-    );
 
-    state_.set({0x00, locked, expenses, reinvestment, time_point(microseconds(0x00))}, get_self());
-  }*/
+    check(!state.exists(), "already initialized");
+    check(reinvestment_rate.is_valid(), "reinvestment rate must be between 0 and 1 (incl.)");
+
+    state.set({
+      0x00,
+      token::get_balance(EOSIO_TOKEN, get_self(), EOS_SYMBOL.code()),
+      asset{0, EOS_SYMBOL},
+      asset{0, EOS_SYMBOL},
+      asset{0, EOS_SYMBOL},
+      asset{0, EOS_SYMBOL},
+      reinvestment_rate,
+      current_time_point()
+    }, get_self());
+  }
+
+  ACTION bank::reconcile() {
+    require_auth(get_self());
+    check(state.exists(), "not initialized");
+
+    auto _state = state.get();
+    _state.balance = token::get_balance(EOSIO_TOKEN, get_self(), EOS_SYMBOL.code());
+    _state.sync    = current_time_point();
+    state.set(_state, get_self());
+  }
+
+  ACTION bank::declare(const name& source, const asset& locked) {
+    require_auth(source);
+    check(state.exists(), "not initialized");
+    check(source == AGENT_ACCOUNT || shards::contains(source), "unknown liability source");
+
+    check(locked.is_valid(), "invalid locked amount");
+    check(locked.amount >= 0, "locked amount must be non-negative");
+    check(locked.symbol == EOS_SYMBOL, "invalid token symbol");
+
+    auto _state = state.get();
+    const auto liability_itr = liabilities.find(source.value);
+
+    if (liability_itr == liabilities.end()) {
+      liabilities.emplace(get_self(), [&](auto& _liability) {
+        _liability.source = source;
+        _liability.locked = locked;
+      });
+    } else {
+      check(liability_itr->locked != locked, "redundant action");
+      _state.locked -= liability_itr->locked;
+      liabilities.modify(liability_itr, same_payer, [&](auto& _liability) {
+        _liability.locked = locked;
+      });
+    }
+
+    _state.locked += locked;
+    state.set(_state, get_self());
+  }
+
+  ACTION bank::reserve(const name& source, const uint64_t& game, const asset& exposure) {
+    require_auth(source);
+    check(state.exists(), "not initialized");
+    check(shards::contains(source), "unknown game shard");
+
+    check(exposure.is_valid(), "invalid exposure");
+    check(exposure.amount >= 0, "exposure amount cannot be negative");
+    check(exposure.symbol == EOS_SYMBOL, "invalid token symbol");
+
+    auto _state = state.get();
+    multi_index_reservations reservations(get_self(), source.value);
+    const auto reservation_itr = reservations.find(game);
+
+    // the game reports its absolute worst case after every funded bet, which stays
+    // the same whenever a bet does not raise the worst cell
+    if (reservation_itr == reservations.end() ? exposure.amount == 0 : reservation_itr->exposure == exposure)
+      return;
+
+    if (exposure.amount == 0) {
+      _state.reserved -= reservation_itr->exposure;
+      state.set(_state, get_self());
+      reservations.erase(reservation_itr);
+      return;
+    }
+
+    if (reservation_itr == reservations.end()) {
+      reservations.emplace(get_self(), [&](auto& _reservation) {
+        _reservation.game     = game;
+        _reservation.exposure = exposure;
+      });
+    } else {
+      _state.reserved -= reservation_itr->exposure;
+      reservations.modify(reservation_itr, same_payer, [&](auto& _reservation) {
+        _reservation.exposure = exposure;
+      });
+    }
+
+    // funding a bet is the only way to grow a reservation, so a bet which the bank
+    // could not pay out is rejected here and every settlement is known to be covered
+    _state.reserved += exposure;
+    check(_state.free_balance().amount >= 0, "bank is unable to cover the bet");
+    state.set(_state, get_self());
+  }
+
+  ACTION bank::release(const name& source, const uint64_t& game) {
+    require_auth(source);
+    check(state.exists(), "not initialized");
+
+    multi_index_reservations reservations(get_self(), source.value);
+    const auto reservation_itr = reservations.require_find(game, "no reservation for the game");
+
+    auto _state = state.get();
+    _state.reserved -= reservation_itr->exposure;
+    state.set(_state, get_self());
+
+    reservations.erase(reservation_itr);
+  }
+
+  ACTION bank::payout(
+    const name&                     source,
+    const vector<payouts::payment>& payments,
+    const uint8_t&                  memo,
+    const string&                   arg
+  ) {
+    require_auth(source);
+    check(source == AGENT_ACCOUNT || shards::contains(source), "unknown payout source");
+    check(!payments.empty(), "no payments");
+
+    string text;
+    switch (static_cast<payouts::memo>(memo)) {
+      case payouts::memo::winner:
+        text = "Winner! Play " + source.to_string() + " at 16bit.game (" + arg + ")";
+        break;
+      case payouts::memo::affiliate_reward:
+        text = "Affiliate reward! Check out affiliate programs at 16bit.partners (" + arg + ")";
+        break;
+      case payouts::memo::affiliate_profit:
+        text = "Affiliate program profit from 16bit.partners";
+        break;
+      case payouts::memo::affiliate_termination:
+        text = "Affiliate program participation termination (16bit.partners)";
+        break;
+      case payouts::memo::deposit_refund:
+        text = "Affiliate license deposit refund (16bit.partners)";
+        break;
+      case payouts::memo::subscription_refund:
+        text = "Subscription refund (16bit.game)";
+        break;
+      default:
+        check(false, "unknown memo template");
+    }
+
+    for (const auto& _payment : payments) {
+      check(_payment.quantity.is_valid(), "invalid payment");
+      check(_payment.quantity.amount > 0, "payment amount must be positive");
+      check(_payment.quantity.symbol == EOS_SYMBOL, "invalid token symbol");
+
+      // the source is the notification target of the transfer (see extended_transfer)
+      action(
+        permission_level{get_self(), CODE_PERMISSION},
+        EOSIO_TOKEN,
+        "transfer"_n,
+        make_tuple(get_self(), _payment.to, _payment.quantity, text, source)
+      ).send();
+    }
+  }
 
   ACTION bank::withdraw(
     const asset&  profit,
@@ -55,7 +201,7 @@ namespace x10bit {
     check(current.expenses.symbol == EOS_SYMBOL, "invalid token symbol");
 
     check(
-      current.reinvestment_rate >= 0 && current.reinvestment_rate <= 1,
+      current.reinvestment_rate.is_valid(),
       "current reinvestment rate must be between 0 and 1 (incl.)"
     );
 
@@ -64,19 +210,25 @@ namespace x10bit {
     check(next.expenses.symbol == EOS_SYMBOL, "invalid token symbol");
 
     check(
-      next.reinvestment_rate >= 0 && next.reinvestment_rate <= 1,
+      next.reinvestment_rate.is_valid(),
       "next reinvestment rate must be between 0 and 1 (incl.)"
     );
 
-    const auto balance = token::get_balance(EOSIO_TOKEN, get_self(), EOS_SYMBOL.code());
-    check(profit + current.expenses <= balance, "overdraft is not allowed");
+    check(state.exists(), "not initialized");
+    auto _state = state.get();
+    check(profit + current.expenses <= _state.free_balance(), "overdraft is not allowed");
+
+    check(current.expenses.amount > 0 || current.reinvestment_rate < rate_t::one(), "redundant action");
+
+    const asset reinvestment = current.reinvestment_rate.apply(profit);
 
-    check(current.expenses.amount > 0 || current.reinvestment_rate < 1, "redundant action");
+    _state.expenses          += current.expenses;
+    _state.reinvestment      += reinvestment;
+    _state.reinvestment_rate  = next.reinvestment_rate;
+    state.set(_state, get_self());
 
-    if (current.reinvestment_rate < 1) {
-      const auto dividends = profit - asset{
-        static_cast<int64_t>(profit.amount * current.reinvestment_rate), EOS_SYMBOL
-      };
+    if (current.reinvestment_rate < rate_t::one()) {
+      const auto dividends = profit - reinvestment;
       action(
         permission_level{get_self(), CODE_PERMISSION},
         EOSIO_TOKEN,
@@ -116,58 +268,41 @@ namespace x10bit {
     check(quantity.symbol == EOS_SYMBOL, "invalid token symbol");
     check(quantity.amount > 0, "transfer amount must be positive");
 
-    //const auto current_action_size  = read_action_data((void *)(NULL), 0);
-    const auto current_action_size = action_data_size();
-    const auto transfer_action_size = action(
-      permission_level{from, "active"_n},
-      EOSIO_TOKEN,
-      "transfer"_n,
-      make_tuple(
-        from,
-        to,
-        quantity,
-        memo
-      )
-    ).data.size();
+    // any contract may forward a notification of its own transfers to the bank, only
+    // those moving the funds of the bank are booked
+    if (get_first_receiver() == EOSIO_TOKEN && from != to && (from == get_self() || to == get_self()) && state.exists()) {
+      auto _state = state.get();
+      _state.balance += to == get_self() ? quantity : -quantity;
+      state.set(_state, get_self());
+    }
 
     if (to == get_self()) {
       check(
         get_sender() == EOSIO_TOKEN,
-        "deposit of " + get_sender().to_string() + " is not allowed"
+        [&] { return "deposit of " + get_sender().to_string() + " is not allowed"; }
       );
 
-      /*if (current_action_size > transfer_action_size) {
-        const auto extended_transfer_data = unpack_action_data<extended_transfer>();
-        check(false, extended_transfer_data.target.to_string());
-        if (extended_transfer_data.target) {
-          //utils::require_account(extended_transfer_data.target);
-          require_recipient(extended_transfer_data.target);
-        }
-      } else if (from == get_self()) {
-        if (current_action_size > transfer_action_size) {
-          const auto extended_transfer_data = unpack_action_data<extended_transfer>();
-          if (extended_transfer_data.target) {
-            utils::require_account(extended_transfer_data.target);
-            require_recipient(extended_transfer_data.target);
-          }
-        }
-      } else { return; }*/
-
-      if (memo.size() == GAME_BET_MEMO_SZ) {
-        require_recipient(GAME_ACCOUNT);
-      } else if (memo == PARTNER_FEE_MEMO) {
-        require_recipient(AGENT_ACCOUNT);
-      } else {
-        if (
-          find(
-            whitelisted_senders.begin(),
-            whitelisted_senders.end(),
-            from
-          ) == whitelisted_senders.end()
-        ) check(memo.empty(), "memo must be empty (spam protection)");
+      const auto header = parse_memo(memo);
+      const auto recipient = memo_routes[static_cast<uint8_t>(header.type)](header);
+
+      if (recipient) {
+        require_recipient(recipient);
+      } else if (header.type == memo_type::text) {
+        check(
+          binary_search(whitelisted_senders.begin(), whitelisted_senders.end(), from),
+          "memo must be empty (spam protection)"
+        );
       }
     } else if (from == get_self()) {
-      require_recipient(GAME_ACCOUNT);
+      // outgoing transfers name the contract they are made for (see extended_transfer),
+      // so only that one is notified instead of fanning out to every game
+      if (action_data_size() > transfer_data_size(memo.size())) {
+        const auto target = unpack_action_data<extended_transfer>().target;
+        if (target && target != get_self()) {
+          check(is_account(target), "notification target does not exist");
+          require_recipient(target);
+        }
+      }
     } else { return; }
   }
 }
@@ -0,0 +1,130 @@
+/**
+ * SPDX-License-Identifier: HashCode-EULA-1.1-or-later
+ *
+ * Description / Summary:   Financial Smart Contract (the "Software")
+ *                          Part of the 16Bit Platform ecosystem
+ *
+ * Authors & Contributors:  Designed and assembled by GeekHack
+ *                          In collaboration with 16Bit team
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * Copyright (c) 2020 GeekHack ÐΞV
+ * Copyright (c) 2021 HashCode Ltd.
+ */
+
+#pragma once
+
+#include <vector>
+#include <eosio/eosio.hpp>
+#include <eosio/action.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/system.hpp>
+#include <eosio/singleton.hpp>
+#include "x10bit/rate.hpp"
+
+using namespace std;
+using namespace eosio;
+
+namespace x10bit {
+  // Payouts are handed over to the bank in batches, the memo of every transfer of
+  // a batch is expanded once by the bank from a template and a single argument
+  namespace payouts {
+    enum class memo : uint8_t {
+      winner,
+      affiliate_reward,
+      affiliate_profit,
+      affiliate_termination,
+      deposit_refund,
+      subscription_refund
+    };
+
+    struct payment {
+      name                                       to;
+      asset                                      quantity;
+
+      EOSLIB_SERIALIZE(payment, (to)(quantity));
+    };
+
+    inline void send(
+      const name&             bank,
+      const permission_level& payer,
+      const vector<payment>&  payments,
+      const memo              template_id,
+      const string&           arg = ""
+    ) {
+      action(
+        payer,
+        bank,
+        "payout"_n,
+        make_tuple(payer.actor, payments, static_cast<uint8_t>(template_id), arg)
+      ).send();
+    }
+  }
+
+  namespace datastore {
+    CONTRACT bank : public contract {
+      public:
+        using contract::contract;
+
+        bank(name receiver, name code, datastream<const char *> ds)
+          : contract(receiver, code, ds),
+            state(receiver, receiver.value),
+            liabilities(receiver, receiver.value)
+          {}
+
+        TABLE state {
+          uint64_t                                 version;
+          asset                                    balance;
+          asset                                    locked;
+          asset                                    reserved;
+          asset                                    expenses;
+          asset                                    reinvestment;
+          rate_t                                   reinvestment_rate;
+          time_point                               sync;
+
+          asset free_balance() const { return balance - locked - reserved; }
+
+          EOSLIB_SERIALIZE(state, (version)(balance)(locked)(reserved)(expenses)
+                                  (reinvestment)(reinvestment_rate)(sync));
+        };
+
+        TABLE liability {
+          name                                     source;
+          asset                                    locked;
+
+          uint64_t primary_key() const { return source.value; }
+
+          EOSLIB_SERIALIZE(liability, (source)(locked));
+        };
+
+        // Worst-case payout of an open game, scoped by the game shard
+        TABLE reservation {
+          uint64_t                                 game;
+          asset                                    exposure;
+
+          uint64_t primary_key() const { return game; }
+
+          EOSLIB_SERIALIZE(reservation, (game)(exposure));
+        };
+
+        static state get_treasury(const name& contract) {
+          singleton_state _state(contract, contract.value);
+          return _state.get();
+        }
+      protected:
+        using singleton_state = singleton<"state"_n, state>;
+        using multi_index_liabilities = multi_index<"liabilities"_n, liability>;
+        using multi_index_reservations = multi_index<"reservations"_n, reservation>;
+
+        singleton_state         state;
+        multi_index_liabilities liabilities;
+    };
+  }
+}
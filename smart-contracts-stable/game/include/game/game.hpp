@@ -21,16 +21,25 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <limits>
 #include <vector>
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/system.hpp>
 #include <eosio/crypto.hpp>
 #include <eosio/singleton.hpp>
+#include <eosio/binary_extension.hpp>
 #include <eosio/transaction.hpp>
 #include "utils/utils.hpp"
+#include "x10bit/accounting.hpp"
+#include "x10bit/check.hpp"
+#include "x10bit/migration.hpp"
+#include "x10bit/shards.hpp"
 
 #define NOTIFY          [[eosio::on_notify("*::transfer")]] void
+#define READONLY        [[eosio::action, eosio::read_only]]
 #define EOS_SYMBOL      symbol("EOS", 4)
 #define EOSIO_TOKEN     name("eosio.token")
 #define HOUSE_ACCOUNT   name("fairbethouse")
@@ -39,6 +48,16 @@
 #define BANK_ACCOUNT    name("fairbet.bank")
 #define CODE_PERMISSION name("code")
 #define JET_LAG_US      milliseconds(1000)
+#define ENROLL_BUDGET   32
+#define METRICS_BUCKET  3600
+#define METRICS_WINDOW  168
+#define GAME_BATCH_MEMO '#'
+#define GAME_PROTOCOL   0x02
+#define HOUSE_SEED_MAX  64 // bytes, v2 games can't be revealed with a longer seed
+
+#ifndef GAME_SHARD
+  #define GAME_SHARD    0
+#endif
 
 using namespace std;
 using namespace eosio;
@@ -52,10 +71,16 @@ namespace x10bit {
       const uint8_t CELL_COEFF = 15;
       const uint8_t PLOWBACK   = 90;
 
+      static_assert(GAME_SHARD < shards::count, "game shard is out of the registry");
+
       game(name receiver, name code, datastream<const char *> ds):
-        contract(receiver, code, ds), games_table(receiver, receiver.value),
+        contract(receiver, code, ds), accountant_(receiver, receiver.value),
+        games_table(receiver, receiver.value, accountant_),
         state_(receiver, receiver.value),
-        bets_table(receiver, receiver.value)
+        schema_(receiver, receiver.value),
+        bets_table(receiver, receiver.value, accountant_),
+        subscriptions_table(receiver, receiver.value, accountant_),
+        metrics_table(receiver, receiver.value, accountant_)
       {}
 
       struct game_rules {
@@ -88,6 +113,23 @@ namespace x10bit {
         EOSLIB_SERIALIZE(st_bet, (game)(seed)(quantity)(numbers));
       };
 
+      struct st_subscription {
+        checksum256             seed;
+        asset                   quantity;
+        vector<uint8_t>         numbers;
+        uint16_t                rounds;
+
+        string to_string() const {
+          const string numbers_concat(numbers.begin(), numbers.end());
+          return
+            checksum256_to_string(seed) +
+            quantity.to_string()        +
+            numbers_concat              +
+            ::to_string(rounds);
+        }
+        EOSLIB_SERIALIZE(st_subscription, (seed)(quantity)(numbers)(rounds));
+      };
+
       struct st_affiliate {
         name                    account;
         uint64_t                license;
@@ -96,15 +138,41 @@ namespace x10bit {
         EOSLIB_SERIALIZE(st_affiliate, (account)(license));
       };
 
+      TABLE usage {
+        vector<accounting::table_usage> tables;
+
+        EOSLIB_SERIALIZE(usage, (tables));
+      };
+
+      TABLE r_metrics {
+        uint64_t                id;
+        time_point_sec          start;
+        asset                   volume;
+        uint64_t                bets;
+        uint64_t                games;
+        asset                   payouts;
+        asset                   house;
+
+        uint64_t primary_key() const { return id; }
+
+        EOSLIB_SERIALIZE(r_metrics, (id)(start)(volume)(bets)(games)(payouts)(house));
+      };
+
       ACTION init(const asset& locked, const public_key& witness);
       ACTION startgame(const st_game& game);
       ACTION logstartgame(const st_game& game, const int64_t& timestamp);
       ACTION bet(const name& player, const st_bet& bet, const vector<st_affiliate>& affiliates, const signature& proof);
       ACTION logbet(const name& player, const st_bet& bet, const checksum256& players_seed, const uint8_t& current_win, const vector<st_affiliate>& affiliates);
+      ACTION subscribe(const name& player, const st_subscription& subscription, const vector<st_affiliate>& affiliates, const signature& proof);
+      ACTION unsubscribe(const name& player, const checksum256& seed);
+      ACTION enroll(const uint64_t& game_id, const uint16_t& limit);
       ACTION endgame(const string& house_seed);
       ACTION logendgame(const checksum256& house_seed_hash, const checksum256& compound_hash, const uint8_t& win);
       ACTION clear(const uint64_t& game_id);
       ACTION migrate(const uint64_t& version);
+      ACTION migratestep(const uint64_t& limit);
+      READONLY usage getusage();
+      READONLY vector<r_metrics> getmetrics();
       //ACTION reset(const uint16_t& count);
 
       NOTIFY deposit(const name& from, const name& to, const asset& quantity, const string& memo);
@@ -119,6 +187,13 @@ namespace x10bit {
         EOSLIB_SERIALIZE(state, (version)(locked)(witness));
       };
 
+      TABLE r_schema {
+        uint64_t                  version;
+        vector<migration::cursor> cursors;
+
+        EOSLIB_SERIALIZE(r_schema, (version)(cursors));
+      };
+
       TABLE r_game {
         uint64_t                id;
         time_point              timestamp;
@@ -126,9 +201,19 @@ namespace x10bit {
         checksum256             players_seed;
         game_rules              rules;
         asset                   bank;
+        binary_extension<vector<asset>> exposure;
+        binary_extension<uint8_t>       protocol;
 
         uint64_t primary_key() const { return id; }
         checksum256 secondary_key() const { return house_seed_hash; }
+
+        // payout owed by the bank if the worst cell for it wins
+        asset worst_exposure() const {
+          asset worst(0, EOS_SYMBOL);
+          for (const auto& _cell : exposure.value_or())
+            worst = max(worst, _cell);
+          return worst;
+        }
       };
       
       TABLE r_bet {
@@ -157,7 +242,31 @@ namespace x10bit {
         );
       };
 
+      TABLE r_subscription {
+        uint64_t                id;
+        time_point              timestamp;
+        name                    player;
+        checksum256             seed;
+        asset                   quantity;
+        vector<uint8_t>         numbers;
+        uint16_t                rounds;
+        bool                    paid;
+        uint64_t                next_game;
+        vector<st_affiliate>    affiliates;
+
+        uint64_t primary_key() const { return id; }
+        checksum256 secondary_key() const { return seed; }
+        uint64_t pending_key() const { return paid ? next_game : numeric_limits<uint64_t>::max(); }
+
+        EOSLIB_SERIALIZE(r_subscription, (id)(timestamp)(player)(seed)
+                                         (quantity)(numbers)(rounds)
+                                         (paid)(next_game)(affiliates)
+        );
+      };
+
       using state_idx = singleton<"state"_n, state>;
+      using usage_idx = singleton<"usage"_n, usage>;
+      using schema_idx = singleton<"schema"_n, r_schema>;
       typedef multi_index< "games"_n, r_game,
         indexed_by< "houseseedhash"_n, const_mem_fun<r_game, checksum256, &r_game::secondary_key> >
         > games_index;
@@ -166,10 +275,49 @@ namespace x10bit {
         indexed_by< "seed"_n, const_mem_fun<r_bet, checksum256, &r_bet::secondary_key> >,
         indexed_by< "gamenumber"_n, const_mem_fun<r_bet, uint128_t, &r_bet::compound_key> >
         > bets_index;
-
-      state_idx   state_;
-      games_index games_table;
-      bets_index  bets_table;
+      typedef multi_index< "subscription"_n, r_subscription,
+        indexed_by< "seed"_n, const_mem_fun<r_subscription, checksum256, &r_subscription::secondary_key> >,
+        indexed_by< "pending"_n, const_mem_fun<r_subscription, uint64_t, &r_subscription::pending_key> >
+        > subscriptions_index;
+      typedef multi_index< "metrics"_n, r_metrics > metrics_index;
+
+      accounting::accountant<usage_idx>            accountant_;
+      state_idx                                    state_;
+      schema_idx                                   schema_;
+      accounting::metered<games_index>             games_table;
+      accounting::metered<bets_index>              bets_table;
+      accounting::metered<subscriptions_index>     subscriptions_table;
+      accounting::metered<metrics_index>           metrics_table;
+
+      void reward_affiliates(const name& player, const vector<st_affiliate>& affiliates, const asset& quantity, const checksum256& house_seed_hash);
+      bool is_valid_affiliate(const name& player, const st_affiliate& _affiliate);
+      void place_bet(const r_game& game, const name& player, const st_bet& bet, const vector<st_affiliate>& affiliates);
+      const r_game& fund_bet(const name& from, const checksum256& seed, asset& funded);
+      void fund_subscription(const name& from, const checksum256& seed, const asset& quantity);
+      uint16_t materialize(const r_game& game, uint16_t budget);
+      void reserve(const r_game& game);
+      void lock(const asset& delta);
+      void migrate_rows(const uint64_t& version, migration::cursor& cursor, uint64_t& budget);
+
+      template<typename Lambda>
+      void track(Lambda&& updater) {
+        const uint32_t bucket = current_time_point().sec_since_epoch() / METRICS_BUCKET;
+        const time_point_sec start(bucket * METRICS_BUCKET);
+        const auto metrics_itr = metrics_table.find(bucket % METRICS_WINDOW);
+
+        if (metrics_itr == metrics_table.end()) {
+          metrics_table.emplace(get_self(), [&](r_metrics& _metrics) {
+            _metrics = {bucket % METRICS_WINDOW, start, asset(0, EOS_SYMBOL), 0, 0, asset(0, EOS_SYMBOL), asset(0, EOS_SYMBOL)};
+            updater(_metrics);
+          });
+        } else {
+          metrics_table.modify(metrics_itr, same_payer, [&](r_metrics& _metrics) {
+            if (_metrics.start != start)
+              _metrics = {_metrics.id, start, asset(0, EOS_SYMBOL), 0, 0, asset(0, EOS_SYMBOL), asset(0, EOS_SYMBOL)};
+            updater(_metrics);
+          });
+        }
+      }
 
       inline bool checksum256_is_empty(const checksum256 cs) {
         uint8_t *first_word = (uint8_t *) &cs.get_array()[0];
@@ -246,6 +394,39 @@ namespace x10bit {
         return c_str;
       }
 
+      // ids of the bets funded by a "#<shard>:<bet id>,<bet id>,..." transfer memo
+      inline vector<uint64_t> parse_batch_memo(const string_view memo) {
+        const auto separator = memo.find(':');
+        check(separator != string_view::npos && separator + 1 < memo.size(), "malformed batch memo");
+        check(memo.substr(1, separator - 1) == ::to_string(GAME_SHARD), "batch belongs to another game shard");
+
+        // every entry is a non-empty decimal id and funds a distinct bet
+        const auto append = [](vector<uint64_t>& ids, const uint64_t id, const bool empty) {
+          check(!empty, "malformed batch memo");
+          check(find(ids.begin(), ids.end(), id) == ids.end(), "duplicate bet in batch memo");
+          ids.push_back(id);
+        };
+
+        vector<uint64_t> ids;
+        uint64_t id = 0;
+        bool empty = true;
+        for (const char c : memo.substr(separator + 1)) {
+          if (c == ',') {
+            append(ids, id, empty);
+            id = 0;
+            empty = true;
+          } else {
+            check(c >= '0' && c <= '9', "malformed batch memo");
+            const uint64_t digit = c - '0';
+            check(id <= (UINT64_MAX - digit) / 10, "bet id overflow in batch memo");
+            id = id * 10 + digit;
+            empty = false;
+          }
+        }
+        append(ids, id, empty);
+        return ids;
+      }
+
       inline int64_t to_milliseconds(const microseconds& m) {
         return m._count / 1000;
       }
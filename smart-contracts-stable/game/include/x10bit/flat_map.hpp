@@ -0,0 +1,143 @@
+/**
+ * SPDX-License-Identifier: HashCode-EULA-1.1-or-later
+ *
+ * Description / Summary:   Flat Sorted Map (the "Software")
+ *                          Part of the 16Bit Platform ecosystem
+ *
+ * Authors & Contributors:  Designed and assembled by GeekHack
+ *                          In collaboration with 16Bit team
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * Copyright (c) 2020 GeekHack ÐΞV
+ * Copyright (c) 2021 HashCode Ltd.
+ */
+
+#pragma once
+
+
+#include <algorithm>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+#include <eosio/eosio.hpp>
+
+using namespace std;
+using namespace eosio;
+
+namespace x10bit {
+  // Sorted vector of pairs standing in for std::map where a row holds a handful of
+  // keys. It is read straight into contiguous storage and goes over the wire just
+  // like std::map: the number of entries followed by the key-value pairs in order.
+  template<typename K, typename V>
+  class flat_map {
+    public:
+      using key_type       = K;
+      using mapped_type    = V;
+      using value_type     = pair<K, V>;
+      using iterator       = typename vector<value_type>::iterator;
+      using const_iterator = typename vector<value_type>::const_iterator;
+
+      flat_map() = default;
+
+      flat_map(initializer_list<value_type> init) {
+        for (const auto& item : init)
+          insert(item);
+      }
+
+      iterator       begin()       { return items.begin(); }
+      iterator       end()         { return items.end(); }
+      const_iterator begin() const { return items.begin(); }
+      const_iterator end()   const { return items.end(); }
+
+      size_t size()  const { return items.size(); }
+      bool   empty() const { return items.empty(); }
+
+      iterator find(const K& key) {
+        const auto itr = lower_bound(key);
+        return (itr != items.end() && itr->first == key) ? itr : items.end();
+      }
+
+      const_iterator find(const K& key) const {
+        const auto itr = lower_bound(key);
+        return (itr != items.end() && itr->first == key) ? itr : items.end();
+      }
+
+      bool contains(const K& key) const { return find(key) != items.end(); }
+
+      V& at(const K& key) {
+        const auto itr = find(key);
+        check(itr != items.end(), "flat_map::at: key not found");
+        return itr->second;
+      }
+
+      const V& at(const K& key) const {
+        const auto itr = find(key);
+        check(itr != items.end(), "flat_map::at: key not found");
+        return itr->second;
+      }
+
+      pair<iterator, bool> insert(const value_type& item) {
+        const auto itr = lower_bound(item.first);
+        if (itr != items.end() && itr->first == item.first)
+          return {itr, false};
+        return {items.insert(itr, item), true};
+      }
+
+      iterator erase(const_iterator itr) { return items.erase(itr); }
+
+      size_t erase(const K& key) {
+        const auto itr = find(key);
+        if (itr == items.end())
+          return 0;
+        items.erase(itr);
+        return 1;
+      }
+
+      void clear() { items.clear(); }
+
+      template<typename DataStream>
+      friend DataStream& operator<<(DataStream& ds, const flat_map& map) {
+        ds << unsigned_int(map.items.size());
+        for (const auto& [key, value] : map.items)
+          ds << key << value;
+        return ds;
+      }
+
+      // Rows are written in key order by std::map and by this class alike, the
+      // order is still enforced so that a hand-crafted row can't break lookups
+      template<typename DataStream>
+      friend DataStream& operator>>(DataStream& ds, flat_map& map) {
+        unsigned_int count;
+        ds >> count;
+        map.items.clear();
+        map.items.reserve(count.value);
+        for (uint32_t i = 0; i < count.value; i++) {
+          value_type item;
+          ds >> item.first >> item.second;
+          check(map.items.empty() || map.items.back().first < item.first, "flat_map: unordered keys");
+          map.items.push_back(move(item));
+        }
+        return ds;
+      }
+
+    private:
+      vector<value_type> items;
+
+      iterator lower_bound(const K& key) {
+        return std::lower_bound(items.begin(), items.end(), key,
+          [](const value_type& item, const K& key) { return item.first < key; });
+      }
+
+      const_iterator lower_bound(const K& key) const {
+        return std::lower_bound(items.begin(), items.end(), key,
+          [](const value_type& item, const K& key) { return item.first < key; });
+      }
+  };
+}
@@ -0,0 +1,97 @@
+/**
+ * SPDX-License-Identifier: HashCode-EULA-1.1-or-later
+ *
+ * Description / Summary:   Fixed-Point Rate Type (the "Software")
+ *                          Part of the 16Bit Platform ecosystem
+ *
+ * Authors & Contributors:  Designed and assembled by GeekHack
+ *                          In collaboration with 16Bit team
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * Copyright (c) 2020 GeekHack ÐΞV
+ * Copyright (c) 2021 HashCode Ltd.
+ */
+
+#pragma once
+
+#include <string>
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+
+using namespace std;
+using namespace eosio;
+
+namespace x10bit {
+  // Rate in parts per million, applied with integer math only. It takes the 4 bytes
+  // of the float it replaces, so rows written before the switch are still readable:
+  // anything above one million is the bit pattern of a legacy float in [0, 1] and
+  // is decoded on read until the row is rewritten by the migration.
+  struct rate_t {
+    static constexpr uint32_t PPM = 1'000'000;
+
+    uint32_t                 ppm;
+
+    static constexpr rate_t one() { return {PPM}; }
+
+    constexpr uint32_t value() const {
+      return ppm > PPM ? decode(ppm) : ppm;
+    }
+
+    constexpr rate_t normalized() const { return {value()}; }
+
+    // Checks of action inputs: within [0, 1] in the ppm encoding, legacy floats are
+    // only decoded from stored rows and must not be written anew
+    constexpr bool is_valid() const { return ppm <= PPM; }
+
+    // within (0, 1), in the ppm encoding as well
+    constexpr bool is_fraction() const { return ppm > 0 && ppm < PPM; }
+
+    // Share of the amount, rounded toward zero so that a payout never exceeds the
+    // exact product
+    constexpr int64_t apply(const int64_t amount) const {
+      return static_cast<int64_t>(static_cast<__int128>(amount) * value() / PPM);
+    }
+
+    asset apply(const asset& quantity) const {
+      return asset{apply(quantity.amount), quantity.symbol};
+    }
+
+    string to_string() const {
+      const auto fraction = std::to_string(PPM + value() % PPM).substr(1);
+      return std::to_string(value() / PPM) + "." + fraction;
+    }
+
+    friend constexpr bool operator==(const rate_t& a, const rate_t& b) { return a.value() == b.value(); }
+    friend constexpr bool operator!=(const rate_t& a, const rate_t& b) { return a.value() != b.value(); }
+    friend constexpr bool operator< (const rate_t& a, const rate_t& b) { return a.value() <  b.value(); }
+    friend constexpr bool operator<=(const rate_t& a, const rate_t& b) { return a.value() <= b.value(); }
+    friend constexpr bool operator> (const rate_t& a, const rate_t& b) { return a.value() >  b.value(); }
+    friend constexpr bool operator>=(const rate_t& a, const rate_t& b) { return a.value() >= b.value(); }
+
+    EOSLIB_SERIALIZE(rate_t, (ppm));
+
+    private:
+      // IEEE-754 single precision to ppm, rounded half up; values out of [0, 1]
+      // were never accepted, they decode to zero
+      static constexpr uint32_t decode(const uint32_t bits) {
+        const uint32_t exponent = (bits >> 23) & 0xFF;
+        const uint64_t mantissa = (bits & 0x7FFFFF) | (exponent ? 0x800000 : 0);
+
+        if (bits >> 31 || exponent > 127 || (exponent == 127 && mantissa != 0x800000))
+          return 0;
+
+        const uint32_t shift = 150 - (exponent ? exponent : 1);
+        if (shift > 63)
+          return 0;
+
+        return static_cast<uint32_t>(((mantissa * PPM) + (uint64_t(1) << (shift - 1))) >> shift);
+      }
+  };
+}
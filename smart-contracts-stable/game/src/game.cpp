@@ -28,6 +28,7 @@ namespace x10bit {
     require_auth(get_self());
     
     check(!state_.exists(), "already initialized");
+    check(get_self() == shards::accounts[GAME_SHARD], "shard identity mismatch");
     check(locked.is_valid(), "invalid locked asset");
     check(locked.amount >= 0, "locked amount must be non-negative");
     check(locked.symbol == EOS_SYMBOL, "foreign currency is not accepted");
@@ -50,14 +51,19 @@ namespace x10bit {
     check(game_itr == games_by_houseseedhash.end(), "this game was already initiated");
 
     time_point timestamp = current_time_point() + JET_LAG_US;
-    games_table.emplace(get_self(), [&](r_game& _game) {
+    const auto new_game_itr = games_table.emplace(get_self(), [&](r_game& _game) {
       _game.id = games_table.available_primary_key();
       _game.timestamp = timestamp;
       _game.house_seed_hash = game.house_seed_hash;
       _game.rules = game.rules;
       _game.bank = asset(0, EOS_SYMBOL);
+      // extensions are serialized in order, the exposure has to precede the protocol
+      _game.exposure.emplace(vector<asset>(GAME_CELLS, asset(0, EOS_SYMBOL)));
+      _game.protocol.emplace(GAME_PROTOCOL);
     });
 
+    materialize(*new_game_itr, ENROLL_BUDGET);
+
     action(
       permission_level{get_self(), "active"_n},
       get_self(),
@@ -78,6 +84,7 @@ namespace x10bit {
 
     check(game_itr != games_by_houseseedhash.end(), "this game does not exists");
     check(!checksum256_is_empty(bet.seed), "seed must not be empty");
+    check(shards::of(bet.seed) == GAME_SHARD, "seed belongs to another game shard");
     check(bet.quantity >= game_itr->rules.step, "bet amount too low");
     check(bet.quantity.symbol == EOS_SYMBOL, "foreign currency is not accepted");
     check(!bet.numbers.empty(), "bet numbers can not be empty");
@@ -86,6 +93,9 @@ namespace x10bit {
     auto bet_itr = bets_by_seed.find(bet.seed);
     check(bet_itr == bets_by_seed.end(), "seed collision occurred"); // apply context of the concrete game
 
+    auto subscriptions_by_seed = subscriptions_table.get_index<"seed"_n>();
+    check(subscriptions_by_seed.find(bet.seed) == subscriptions_by_seed.end(), "seed collision occurred");
+
     string payload = player.to_string() + bet.to_string();
     if (!affiliates.empty()) {
       for (const auto& _affiliate: affiliates) {
@@ -125,7 +135,7 @@ namespace x10bit {
     if (to == get_self()) {
       check(
         get_sender() == EOSIO_TOKEN,
-        "deposit of " + get_sender().to_string() + " is not allowed"
+        [&] { return "deposit of " + get_sender().to_string() + " is not allowed"; }
       );
     }
     if (from == get_self() || from == BANK_ACCOUNT || to != BANK_ACCOUNT || memo.empty()) { return; }
@@ -133,95 +143,112 @@ namespace x10bit {
     check(quantity.amount > 0, "amount cannot be zero");
     check(quantity.symbol == EOS_SYMBOL, "foreign currency is not accepted");
 
+    if (memo[0] == GAME_BATCH_MEMO) {
+      const auto ids = parse_batch_memo(memo);
+
+      asset funded(0, EOS_SYMBOL);
+      vector<uint64_t> games;
+      for (const auto& _id : ids) {
+        const auto seed = bets_table.get(_id, "bet does not exist").seed;
+        const auto& game = fund_bet(from, seed, funded);
+        if (find(games.begin(), games.end(), game.id) == games.end())
+          games.push_back(game.id);
+      }
+      check(funded == quantity, [&] { return "batch amount must be eq. " + funded.to_string(); });
+
+      for (const auto& _game_id : games)
+        reserve(games_table.get(_game_id));
+      return;
+    }
+
     checksum256 seed = hexstring_to_checksum256(memo);
 
     auto bets_by_seed = bets_table.get_index<"seed"_n>();
-    auto bet_itr = bets_by_seed.require_find(seed, "bet does not exist");
-    auto bet_end_itr = bets_by_seed.upper_bound(seed);
-    auto game_itr = games_table.find(bet_itr->game_id);
-    check(bet_itr->player == from, "it is not your bet");
-    check(!bet_itr->paid, "bet was already deposited");
-    check(bet_itr->quantity == quantity, "bet amount must be eq. " + bet_itr->quantity.to_string());
+    if (bets_by_seed.find(seed) == bets_by_seed.end()) {
+      fund_subscription(from, seed, quantity);
+      return;
+    }
 
-    if (!bet_itr->affiliates.empty()) {
-      for (const auto& _affiliate : bet_itr->affiliates) {
-        check(is_account(_affiliate.account), "affiliate account does not exist");
-        check(_affiliate.account != bet_itr->player, "affiliate recursion is prohibited");
+    asset funded(0, EOS_SYMBOL);
+    const auto& game = fund_bet(from, seed, funded);
+    check(funded == quantity, [&] { return "bet amount must be eq. " + funded.to_string(); });
+    reserve(game);
+  }
 
-        const auto license = affiliate::get_license(
-          AGENT_ACCOUNT, _affiliate.license,
-          string("invalid affiliate license for " + _affiliate.account.to_string()).c_str()
-        );
+  ACTION game::logbet(const name& player, const st_bet& bet, const checksum256& players_seed, const uint8_t& current_win, const vector<st_affiliate>& affiliates) {
+    require_auth(get_self());
+  };
 
-        if (license.terms.global_program) {
-          const auto partner = affiliate::get_partner(
-            AGENT_ACCOUNT, _affiliate.account,
-            string(_affiliate.account.to_string() + " is not a valid partner").c_str()
-          );
-          check(
-            utils::contains(partner.contracts, _affiliate.license),
-            "license spoofing for " + _affiliate.account.to_string()
-          );
-        } else if (
-          license.terms.instant_payout &&
-          license.rate.payer == utils::to_underlying(affiliate::license_rate::payer::platform)
-        ) {
-          const auto fixed_rate = get_if<affiliate::license_rate::fixed>(&license.rate.limit);
-          check(fixed_rate != nullptr, "invalid rate type for " + _affiliate.account.to_string());
-          action(
-            permission_level{BANK_ACCOUNT, CODE_PERMISSION},
-            "eosio.token"_n,
-            "transfer"_n,
-            make_tuple(
-              BANK_ACCOUNT,
-              _affiliate.account,
-              asset{static_cast<int64_t>(quantity.amount * *fixed_rate), EOS_SYMBOL},
-              license.name + " reward! Check out affiliate programs at 16bit.partners (" + bet_itr->player.to_string() + ", " + checksum256_to_string(invert_checksum256(game_itr->house_seed_hash)) + ")",
-              get_self()
-            )
-          ).send();
-        }
-      }
-    }
+  ACTION game::subscribe(const name& player, const st_subscription& subscription, const vector<st_affiliate>& affiliates, const signature& proof) {
+    require_auth(player);
 
-    st_bet bet{
-      game_itr->house_seed_hash,
-      bet_itr->seed,
-      bet_itr->quantity,
-      {}
-    };
+    check(!checksum256_is_empty(subscription.seed), "seed must not be empty");
+    check(shards::of(subscription.seed) == GAME_SHARD, "seed belongs to another game shard");
+    check(subscription.quantity.is_valid(), "invalid subscription amount");
+    check(subscription.quantity.amount > 0, "subscription amount must be positive");
+    check(subscription.quantity.symbol == EOS_SYMBOL, "foreign currency is not accepted");
+    check(!subscription.numbers.empty(), "bet numbers can not be empty");
+    check(subscription.rounds > 0, "number of rounds must be positive");
 
-    const auto affiliates = bet_itr->affiliates;
+    auto subscriptions_by_seed = subscriptions_table.get_index<"seed"_n>();
+    check(subscriptions_by_seed.find(subscription.seed) == subscriptions_by_seed.end(), "seed collision occurred");
 
-    for (bet_itr = bet_itr; bet_itr != bet_end_itr; bet_itr++) {
-      bets_table.modify(*bet_itr, get_self(), [&](r_bet& _bet) {
-        _bet.paid = true;
-      });
-      bet.numbers.emplace_back(bet_itr->number);
-    }
+    auto bets_by_seed = bets_table.get_index<"seed"_n>();
+    check(bets_by_seed.find(subscription.seed) == bets_by_seed.end(), "seed collision occurred");
 
-    if (!checksum256_is_empty(game_itr->players_seed)) {
-      seed = combine_checksum256(game_itr->players_seed, seed);
+    string payload = player.to_string() + subscription.to_string();
+    for (const auto& _affiliate: affiliates) {
+      payload += _affiliate.to_string();
     }
-    
-    games_table.modify(game_itr, same_payer, [&](r_game& _game) {
-      _game.players_seed = seed;
-      _game.bank += quantity;
+
+    vector<char> bytes(payload.begin(), payload.end());
+    bytes.resize(bytes.size() + 32, 0);
+
+    const checksum256 digest = sha256(bytes.data(), bytes.size());
+    assert_recover_key(digest, proof, state_.get().witness);
+
+    subscriptions_table.emplace(get_self(), [&](r_subscription& _subscription) {
+      _subscription.id = subscriptions_table.available_primary_key();
+      _subscription.timestamp = current_time_point();
+      _subscription.player = player;
+      _subscription.seed = subscription.seed;
+      _subscription.quantity = subscription.quantity;
+      _subscription.numbers = subscription.numbers;
+      _subscription.rounds = subscription.rounds;
+      _subscription.paid = false;
+      _subscription.next_game = 0;
+      _subscription.affiliates = affiliates;
     });
+  }
 
-    const uint8_t current_win = (seed.get_array()[0] + seed.get_array()[1]) % GAME_CELLS;
+  ACTION game::unsubscribe(const name& player, const checksum256& seed) {
+    require_auth(player);
 
-    action(
-      permission_level{get_self(), "active"_n},
-      get_self(),
-      "logbet"_n,
-      make_tuple(from, bet, seed, current_win, affiliates)
-    ).send();
+    auto subscriptions_by_seed = subscriptions_table.get_index<"seed"_n>();
+    auto subscription_itr = subscriptions_by_seed.require_find(seed, "subscription does not exist");
+    check(subscription_itr->player == player, "it is not your subscription");
+
+    const auto refund = subscription_itr->quantity * subscription_itr->rounds;
+    const auto paid = subscription_itr->paid;
+
+    subscriptions_table.erase(*subscription_itr);
+
+    if (paid) {
+      lock(-refund);
+      payouts::send(
+        BANK_ACCOUNT, {get_self(), "active"_n},
+        {{player, refund}}, payouts::memo::subscription_refund
+      );
+    }
   }
 
-  ACTION game::logbet(const name& player, const st_bet& bet, const checksum256& players_seed, const uint8_t& current_win, const vector<st_affiliate>& affiliates) {
-    require_auth(get_self());
-  };
+  ACTION game::enroll(const uint64_t& game_id, const uint16_t& limit) {
+    require_auth(HOUSE_ACCOUNT);
+
+    check(limit > 0, "limit must be positive");
+    const auto& game = games_table.get(game_id, "no such game");
+    check(materialize(game, limit) > 0, "redundant action");
+  }
 
   ACTION game::endgame(const string& house_seed) {
     require_auth(HOUSE_ACCOUNT);
@@ -233,33 +260,76 @@ namespace x10bit {
     
     check(game_itr != games_by_houseseedhash.end(), "no such game");
 
-    string compound_hash_str = checksum256_to_string(invert_checksum256(game_itr->players_seed)) + house_seed;
-    checksum256 compound_hash = invert_checksum256(sha256(compound_hash_str.data(), compound_hash_str.size()));
-    const uint8_t win = (compound_hash.get_array()[0] + compound_hash.get_array()[1]) % GAME_CELLS;
+    checksum256 compound_hash;
+    uint8_t win;
+
+    if (game_itr->protocol.value_or(0x01) >= 0x02) {
+      // v2: sha256([0x02][players seed, 32 bytes][house seed]), the winning cell is the
+      // first byte of the digest modulo the number of cells (see verifier/verify.cpp)
+      check(house_seed.size() <= HOUSE_SEED_MAX, "house seed is too long");
+
+      // checksums are stored as words, digest order is the byte array extracted from them
+      const auto players_seed = game_itr->players_seed.extract_as_byte_array();
+
+      array<char, 1 + 32 + HOUSE_SEED_MAX> preimage;
+      preimage[0] = 0x02;
+      memcpy(preimage.data() + 1, players_seed.data(), players_seed.size());
+      memcpy(preimage.data() + 33, house_seed.data(), house_seed.size());
+
+      compound_hash = sha256(preimage.data(), 33 + house_seed.size());
+      win = compound_hash.extract_as_byte_array()[0] % GAME_CELLS;
+    } else {
+      string compound_hash_str = checksum256_to_string(invert_checksum256(game_itr->players_seed)) + house_seed;
+      compound_hash = invert_checksum256(sha256(compound_hash_str.data(), compound_hash_str.size()));
+      win = (compound_hash.get_array()[0] + compound_hash.get_array()[1]) % GAME_CELLS;
+    }
 
     auto bets_by_gamenumber = bets_table.get_index<"gamenumber"_n>();
     auto bet_itr = bets_by_gamenumber.find(r_bet::build_compound_key(game_itr->id, win));
 
+    auto bet_end_itr = bets_by_gamenumber.upper_bound(r_bet::build_compound_key(game_itr->id, win));
+
     string game_hash = checksum256_to_string(invert_checksum256(game_itr->house_seed_hash));
+    asset total(0, EOS_SYMBOL);
+    vector<payouts::payment> payments;
 
-    while (bet_itr != bets_by_gamenumber.end()) {
+    while (bet_itr != bet_end_itr) {
       if ((bet_itr->player != get_self()) && bet_itr->paid && (bet_itr->number == win) && (bet_itr->coefficient > 0)) {
-        action(
-          permission_level(BANK_ACCOUNT, CODE_PERMISSION),
-          "eosio.token"_n,
-          "transfer"_n,
-          make_tuple(
-            BANK_ACCOUNT,
-            bet_itr->player,
-            bet_itr->quantity * bet_itr->coefficient,
-            "Winner! Play " + get_self().to_string() + " at 16bit.game (" + game_hash + ")",
-            get_self()
-          )
-        ).send();
+        const auto prize = bet_itr->quantity * bet_itr->coefficient;
+        total += prize;
+
+        // several winning bets of a player are paid out by a single transfer
+        auto payment_itr = find_if(payments.begin(), payments.end(), [&](const payouts::payment& _payment) {
+          return _payment.to == bet_itr->player;
+        });
+        if (payment_itr == payments.end()) {
+          payments.push_back({bet_itr->player, prize});
+        } else {
+          payment_itr->quantity += prize;
+        }
       }
       bet_itr++;
     }
 
+    if (!payments.empty()) {
+      payouts::send(BANK_ACCOUNT, {get_self(), "active"_n}, payments, payouts::memo::winner, game_hash);
+    }
+
+    if (game_itr->worst_exposure().amount > 0) {
+      action(
+        permission_level{get_self(), "active"_n},
+        BANK_ACCOUNT,
+        "release"_n,
+        make_tuple(get_self(), game_itr->id)
+      ).send();
+    }
+
+    track([&](r_metrics& _metrics) {
+      _metrics.games   += 1;
+      _metrics.payouts += total;
+      _metrics.house   += game_itr->bank - total;
+    });
+
     action(
       permission_level{get_self(), "active"_n},
       get_self(),
@@ -290,27 +360,352 @@ namespace x10bit {
     auto bet_end_itr = bets_by_game.upper_bound(game_id);
 
     while (bet_itr != bet_end_itr) {
-      bet_itr = bets_by_game.erase(bet_itr);
+      const auto& bet = *bet_itr;
+      bet_itr++;
+      bets_table.erase(bet);
     }
 
     games_table.erase(game_itr);
   }
 
+  void game::reward_affiliates(const name& player, const vector<st_affiliate>& affiliates, const asset& quantity, const checksum256& house_seed_hash) {
+    vector<payouts::payment> payments;
+
+    for (const auto& _affiliate : affiliates) {
+      check(is_account(_affiliate.account), "affiliate account does not exist");
+      check(_affiliate.account != player, "affiliate recursion is prohibited");
+
+      const auto license = affiliate::find_descriptor(AGENT_ACCOUNT, _affiliate.license);
+      check(license.has_value(), [&] { return "invalid affiliate license for " + _affiliate.account.to_string(); });
+
+      if (license->is(affiliate::descriptor::global_program)) {
+        const auto partner = affiliate::find_partner(AGENT_ACCOUNT, _affiliate.account);
+        check(partner.has_value(), [&] { return _affiliate.account.to_string() + " is not a valid partner"; });
+        check(
+          partner->contracts.contains(_affiliate.license),
+          [&] { return "license spoofing for " + _affiliate.account.to_string(); }
+        );
+      } else if (license->is(affiliate::descriptor::instant_payout | affiliate::descriptor::platform_payer)) {
+        check(
+          license->is(affiliate::descriptor::rate_kind::fixed),
+          [&] { return "invalid rate type for " + _affiliate.account.to_string(); }
+        );
+
+        const asset reward = license->from.apply(quantity);
+        if (reward.amount > 0)
+          payments.push_back({_affiliate.account, reward});
+      }
+    }
+
+    if (!payments.empty()) {
+      payouts::send(
+        BANK_ACCOUNT, {get_self(), "active"_n}, payments, payouts::memo::affiliate_reward,
+        player.to_string() + ", " + checksum256_to_string(invert_checksum256(house_seed_hash))
+      );
+    }
+  }
+
+  bool game::is_valid_affiliate(const name& player, const st_affiliate& _affiliate) {
+    if (!is_account(_affiliate.account) || _affiliate.account == player)
+      return false;
+
+    const auto license = affiliate::find_descriptor(AGENT_ACCOUNT, _affiliate.license);
+    if (!license.has_value())
+      return false;
+
+    if (license->is(affiliate::descriptor::global_program)) {
+      const auto partner = affiliate::find_partner(AGENT_ACCOUNT, _affiliate.account);
+      return partner.has_value() && partner->contracts.contains(_affiliate.license);
+    }
+
+    return !license->is(affiliate::descriptor::instant_payout | affiliate::descriptor::platform_payer) ||
+      license->is(affiliate::descriptor::rate_kind::fixed);
+  }
+
+  void game::place_bet(const r_game& game, const name& player, const st_bet& bet, const vector<st_affiliate>& affiliates) {
+    reward_affiliates(player, affiliates, bet.quantity, game.house_seed_hash);
+
+    checksum256 seed = bet.seed;
+    if (!checksum256_is_empty(game.players_seed)) {
+      seed = combine_checksum256(game.players_seed, seed);
+    }
+
+    const uint8_t coeff = CELL_COEFF / bet.numbers.size();
+    games_table.modify(game, same_payer, [&](r_game& _game) {
+      auto exposure = _game.exposure.value_or(vector<asset>(GAME_CELLS, asset(0, EOS_SYMBOL)));
+      for (const uint8_t& _number: bet.numbers) {
+        if (_number < GAME_CELLS)
+          exposure[_number] += bet.quantity * coeff;
+      }
+
+      _game.players_seed = seed;
+      _game.bank += bet.quantity;
+      _game.exposure.emplace(move(exposure));
+    });
+
+    track([&](r_metrics& _metrics) {
+      _metrics.volume += bet.quantity;
+      _metrics.bets   += 1;
+    });
+
+    const uint8_t current_win = (seed.get_array()[0] + seed.get_array()[1]) % GAME_CELLS;
+
+    action(
+      permission_level{get_self(), "active"_n},
+      get_self(),
+      "logbet"_n,
+      make_tuple(player, bet, seed, current_win, affiliates)
+    ).send();
+  }
+
+  const game::r_game& game::fund_bet(const name& from, const checksum256& seed, asset& funded) {
+    auto bets_by_seed = bets_table.get_index<"seed"_n>();
+    auto bet_itr = bets_by_seed.require_find(seed, "bet does not exist");
+    auto bet_end_itr = bets_by_seed.upper_bound(seed);
+    const auto& game = games_table.get(bet_itr->game_id, "no such game");
+    check(bet_itr->player == from, "it is not your bet");
+    check(!bet_itr->paid, "bet was already deposited");
+
+    st_bet bet{
+      game.house_seed_hash,
+      bet_itr->seed,
+      bet_itr->quantity,
+      {}
+    };
+
+    const auto affiliates = bet_itr->affiliates;
+
+    for (; bet_itr != bet_end_itr; bet_itr++) {
+      bets_table.modify(*bet_itr, get_self(), [&](r_bet& _bet) {
+        _bet.paid = true;
+      });
+      bet.numbers.emplace_back(bet_itr->number);
+    }
+
+    place_bet(game, from, bet, affiliates);
+    funded += bet.quantity;
+    return game;
+  }
+
+  void game::fund_subscription(const name& from, const checksum256& seed, const asset& quantity) {
+    auto subscriptions_by_seed = subscriptions_table.get_index<"seed"_n>();
+    auto subscription_itr = subscriptions_by_seed.require_find(seed, "bet does not exist");
+    check(subscription_itr->player == from, "it is not your subscription");
+    check(!subscription_itr->paid, "subscription was already deposited");
+
+    const auto total = subscription_itr->quantity * subscription_itr->rounds;
+    check(total == quantity, [&] { return "subscription amount must be eq. " + total.to_string(); });
+
+    subscriptions_table.modify(*subscription_itr, same_payer, [&](r_subscription& _subscription) {
+      _subscription.paid = true;
+      _subscription.next_game = games_table.available_primary_key();
+    });
+    lock(quantity);
+  }
+
+  uint16_t game::materialize(const r_game& game, uint16_t budget) {
+    auto subscriptions_by_pending = subscriptions_table.get_index<"pending"_n>();
+    auto subscription_itr = subscriptions_by_pending.begin();
+    uint16_t count = 0;
+    asset consumed(0, EOS_SYMBOL);
+
+    while (
+      count < budget &&
+      subscription_itr != subscriptions_by_pending.end() &&
+      subscription_itr->pending_key() <= game.id
+    ) {
+      const auto& subscription = *subscription_itr;
+      subscription_itr++;
+      count++;
+
+      // a round is consumed only by games whose rules the subscribed bet meets
+      const bool eligible = subscription.quantity >= game.rules.step;
+
+      if (eligible) {
+        // affiliates are verified by the witness once per subscription, those which lost
+        // their program since then are dropped instead of blocking the game opening
+        vector<st_affiliate> affiliates;
+        for (const auto& _affiliate : subscription.affiliates) {
+          if (is_valid_affiliate(subscription.player, _affiliate))
+            affiliates.push_back(_affiliate);
+        }
+
+        const auto house_hash = game.house_seed_hash.extract_as_byte_array();
+        const auto seed_bytes = subscription.seed.extract_as_byte_array();
+        array<uint8_t, 64> preimage;
+        copy(seed_bytes.begin(), seed_bytes.end(), preimage.begin());
+        copy(house_hash.begin(), house_hash.end(), preimage.begin() + 32);
+
+        st_bet bet{
+          game.house_seed_hash,
+          sha256(reinterpret_cast<const char *>(preimage.data()), preimage.size()),
+          subscription.quantity,
+          subscription.numbers
+        };
+
+        const uint8_t coeff = CELL_COEFF / bet.numbers.size();
+        for (const uint8_t& _number: bet.numbers) {
+          bets_table.emplace(get_self(), [&](r_bet& _bet) {
+            _bet.id = bets_table.available_primary_key();
+            _bet.game_id = game.id;
+            _bet.timestamp = current_time_point();
+            _bet.player = subscription.player;
+            _bet.quantity = bet.quantity;
+            _bet.number = _number;
+            _bet.coefficient = coeff;
+            _bet.seed = bet.seed;
+            _bet.paid = true;
+            _bet.affiliates = affiliates;
+          });
+        }
+
+        place_bet(game, subscription.player, bet, affiliates);
+        consumed += subscription.quantity;
+      }
+
+      if (eligible && subscription.rounds == 1) {
+        subscriptions_table.erase(subscription);
+      } else {
+        subscriptions_table.modify(subscription, same_payer, [&](r_subscription& _subscription) {
+          if (eligible) _subscription.rounds -= 1;
+          _subscription.next_game = game.id + 1;
+        });
+      }
+    }
+
+    if (consumed.amount > 0) {
+      lock(-consumed);
+      reserve(game);
+    }
+
+    return count;
+  }
+
+  void game::reserve(const r_game& game) {
+    // a game of bets which can not win (e.g. on every cell) has nothing to reserve
+    if (game.worst_exposure().amount == 0)
+      return;
+
+    action(
+      permission_level{get_self(), "active"_n},
+      BANK_ACCOUNT,
+      "reserve"_n,
+      make_tuple(get_self(), game.id, game.worst_exposure())
+    ).send();
+  }
+
+  // prepaid subscription rounds are liabilities of the shard until they turn into bets
+  void game::lock(const asset& delta) {
+    auto _state = state_.get();
+    _state.locked += delta;
+    state_.set(_state, get_self());
+
+    action(
+      permission_level{get_self(), "active"_n},
+      BANK_ACCOUNT,
+      "declare"_n,
+      make_tuple(get_self(), _state.locked)
+    ).send();
+  }
+
   ACTION game::migrate(const uint64_t& version) {
     require_auth(get_self());
     auto _state = state_.get();
     check(_state.version != version, "redundant action");
     check(_state.version < version, "downgrade is not supported (rollback through subsequent updates)");
+    check(_state.version + 1 == version, "versions must be migrated one by one");
+    check(!schema_.exists(), "migration is already in progress");
 
+    vector<name> tables;
     switch(version) {
       case 0x00:
-          _state.version = 0x00;
+        break;
+      case 0x01: // usage of the metered tables is tallied from scratch
+        tables = {"games"_n, "bets"_n, "subscription"_n, "metrics"_n};
+        for (const auto& _table : tables)
+          accountant_.reset(_table);
         break;
       default:
         check(false, "unknown version");
     }
 
-    state_.set(_state, get_self());
+    if (tables.empty()) {
+      _state.version = version;
+      state_.set(_state, get_self());
+    } else {
+      schema_.set({version, migration::plan(tables)}, get_self());
+    }
+  }
+
+  ACTION game::migratestep(const uint64_t& limit) {
+    require_auth(get_self());
+    check(schema_.exists(), "no migration in progress");
+    check(limit > 0, "limit must be positive");
+
+    auto _schema = schema_.get();
+    uint64_t budget = limit;
+    for (auto& _cursor : _schema.cursors) {
+      if (!_cursor.done)
+        migrate_rows(_schema.version, _cursor, budget);
+      if (budget == 0)
+        break;
+    }
+
+    const bool done = all_of(
+      _schema.cursors.begin(), _schema.cursors.end(),
+      [](const migration::cursor& _cursor) { return _cursor.done; }
+    );
+
+    if (done) {
+      auto _state = state_.get();
+      _state.version = _schema.version;
+      state_.set(_state, get_self());
+      schema_.remove();
+    } else {
+      schema_.set(_schema, get_self());
+    }
+  }
+
+  void game::migrate_rows(const uint64_t& version, migration::cursor& cursor, uint64_t& budget) {
+    switch(version) {
+      case 0x01:
+        // rows written by other actions in between are metered already, so the
+        // tally is exact only if the contract is idle until the migration is over
+        if (cursor.table == "games"_n) {
+          migration::advance(games_table, cursor, budget, [&](const auto& _row) { games_table.tally(_row); });
+        } else if (cursor.table == "bets"_n) {
+          migration::advance(bets_table, cursor, budget, [&](const auto& _row) { bets_table.tally(_row); });
+        } else if (cursor.table == "subscription"_n) {
+          migration::advance(subscriptions_table, cursor, budget, [&](const auto& _row) { subscriptions_table.tally(_row); });
+        } else if (cursor.table == "metrics"_n) {
+          migration::advance(metrics_table, cursor, budget, [&](const auto& _row) { metrics_table.tally(_row); });
+        } else {
+          check(false, "unknown table " + cursor.table.to_string());
+        }
+        break;
+      default:
+        check(false, "no row migrations for version " + ::to_string(version) + " (" + cursor.table.to_string() + ")");
+    }
+  }
+
+  game::usage game::getusage() {
+    return accountant_.get();
+  }
+
+  vector<game::r_metrics> game::getmetrics() {
+    const uint32_t bucket = current_time_point().sec_since_epoch() / METRICS_BUCKET;
+    const time_point_sec oldest((bucket - min<uint32_t>(bucket, METRICS_WINDOW - 1)) * METRICS_BUCKET);
+
+    vector<r_metrics> window;
+    for (const auto& _metrics : metrics_table) {
+      if (_metrics.start >= oldest)
+        window.push_back(_metrics);
+    }
+    sort(window.begin(), window.end(), [](const r_metrics& a, const r_metrics& b) {
+      return a.start < b.start;
+    });
+
+    return window;
   }
 
   /*ACTION game::reset(const uint16_t& count) {
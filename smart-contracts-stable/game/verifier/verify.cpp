@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: HashCode-EULA-1.1-or-later
+//
+// Description / Summary:   Game Fairness Verifier (the "Software")
+//                          Part of the 16Bit Platform ecosystem
+//
+// Authors & Contributors:  Designed and assembled by GeekHack
+//                          In collaboration with 16Bit team
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// Copyright (c) 2020 GeekHack ÐΞV
+// Copyright (c) 2021 HashCode Ltd.
+
+// Reference verifier of fairness protocol v2, standalone on purpose:
+//
+//   c++ -std=c++17 -O2 verify.cpp -o verify
+//   ./verify <house seed> <players seed hex> [<house seed hash hex>]
+//
+// The players seed is the one of the game row (or the last logbet), i.e. the
+// byte-wise sum modulo 256 of the seeds of all bets of the game, in the hex form
+// printed by the chain API. The winning cell is the first byte of
+// sha256([0x02][players seed, 32 bytes][house seed]) modulo 16.
+//
+//   ./verify --selftest
+//
+// checks the pinned vector below, which the contract has to reproduce as well:
+//   house seed    "house-seed-2"
+//   players seed  000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f
+//   compound hash 97138b4918e0d1a2aa9e0baef17c986d7706029bc3cbd8d6e11837c6b6c3152e
+//   winning cell  7
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+  constexpr uint8_t  PROTOCOL   = 0x02;
+  constexpr uint8_t  GAME_CELLS = 16;
+  constexpr size_t   SEED_MAX   = 64;
+
+  using digest = array<uint8_t, 32>;
+
+  constexpr uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+
+  constexpr uint32_t rotr(const uint32_t x, const int n) { return (x >> n) | (x << (32 - n)); }
+
+  digest sha256(const uint8_t* data, const size_t size) {
+    uint32_t h[8] = {
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    vector<uint8_t> message(data, data + size);
+    message.push_back(0x80);
+    while (message.size() % 64 != 56)
+      message.push_back(0x00);
+    const uint64_t bits = uint64_t(size) * 8;
+    for (int i = 7; i >= 0; i--)
+      message.push_back(uint8_t(bits >> (i * 8)));
+
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+      uint32_t w[64];
+      for (int i = 0; i < 16; i++) {
+        const uint8_t* p = &message[chunk + i * 4];
+        w[i] = uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+      }
+      for (int i = 16; i < 64; i++) {
+        const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+      }
+
+      uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+      for (int i = 0; i < 64; i++) {
+        const uint32_t t1 = k + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+      }
+
+      h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+      h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+    }
+
+    digest result;
+    for (int i = 0; i < 32; i++)
+      result[i] = uint8_t(h[i / 4] >> (24 - (i % 4) * 8));
+    return result;
+  }
+
+  bool parse_hex(const string& hex, digest& out) {
+    if (hex.size() != out.size() * 2)
+      return false;
+    for (size_t i = 0; i < out.size(); i++) {
+      unsigned int byte;
+      if (sscanf(hex.c_str() + i * 2, "%02x", &byte) != 1)
+        return false;
+      out[i] = uint8_t(byte);
+    }
+    return true;
+  }
+
+  struct outcome {
+    digest  house_seed_hash;
+    digest  compound_hash;
+    uint8_t win;
+  };
+
+  outcome draw(const string& house_seed, const digest& players_seed) {
+    array<uint8_t, 1 + 32 + SEED_MAX> preimage;
+    preimage[0] = PROTOCOL;
+    memcpy(preimage.data() + 1, players_seed.data(), players_seed.size());
+    memcpy(preimage.data() + 33, house_seed.data(), house_seed.size());
+
+    outcome result;
+    result.house_seed_hash = sha256(
+      reinterpret_cast<const uint8_t *>(house_seed.data()), house_seed.size()
+    );
+    result.compound_hash = sha256(preimage.data(), 33 + house_seed.size());
+    result.win = result.compound_hash[0] % GAME_CELLS;
+    return result;
+  }
+
+  int selftest() {
+    digest players_seed, compound_hash;
+    parse_hex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", players_seed);
+    parse_hex("97138b4918e0d1a2aa9e0baef17c986d7706029bc3cbd8d6e11837c6b6c3152e", compound_hash);
+
+    const auto result = draw("house-seed-2", players_seed);
+    if (result.compound_hash != compound_hash || result.win != 7) {
+      fprintf(stderr, "pinned vector mismatch\n");
+      return 1;
+    }
+    printf("ok\n");
+    return 0;
+  }
+
+  string to_hex(const digest& bytes) {
+    string hex;
+    char pair[3];
+    for (const auto byte : bytes) {
+      snprintf(pair, sizeof(pair), "%02x", byte);
+      hex += pair;
+    }
+    return hex;
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc == 2 && string(argv[1]) == "--selftest")
+    return selftest();
+
+  if (argc < 3 || argc > 4) {
+    fprintf(stderr, "usage: %s <house seed> <players seed hex> [<house seed hash hex>]\n", argv[0]);
+    return 2;
+  }
+
+  const string house_seed = argv[1];
+  digest players_seed;
+
+  if (house_seed.size() > SEED_MAX) {
+    fprintf(stderr, "house seed is too long\n");
+    return 2;
+  }
+  if (!parse_hex(argv[2], players_seed)) {
+    fprintf(stderr, "players seed must be 64 hex characters\n");
+    return 2;
+  }
+
+  const auto result = draw(house_seed, players_seed);
+  if (argc == 4) {
+    digest committed;
+    if (!parse_hex(argv[3], committed) || committed != result.house_seed_hash) {
+      fprintf(stderr, "house seed does not match the committed hash\n");
+      return 1;
+    }
+  }
+
+  printf("house seed hash: %s\n", to_hex(result.house_seed_hash).c_str());
+  printf("compound hash:   %s\n", to_hex(result.compound_hash).c_str());
+  printf("winning cell:    %u\n", result.win);
+  return 0;
+}